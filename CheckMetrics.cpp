@@ -0,0 +1,127 @@
+//===--- CheckMetrics.cpp - clang-tidy ------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "CheckMetrics.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+#include <sys/resource.h>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+namespace {
+
+/// Checks are created per TU on the thread that analyzes it, and the previous
+/// TU's are destroyed before the next TU's are created.
+thread_local std::weak_ptr<TuMetrics> CurrentTu;
+thread_local CheckCounters *ActiveCheck = nullptr;
+
+int64_t toMicroseconds(std::chrono::nanoseconds Time) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Time).count();
+}
+
+/// Peak resident set size of the process so far, in KiB.
+int64_t getPeakRss() {
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage))
+    return 0;
+  return Usage.ru_maxrss;
+}
+
+} // namespace
+
+std::shared_ptr<TuMetrics>
+TuMetrics::getForNewCheck(llvm::StringRef OutputFile) {
+  std::shared_ptr<TuMetrics> Metrics = CurrentTu.lock();
+  if (!Metrics || Metrics->OutputFile != OutputFile ||
+      !Metrics->MainFile.empty()) {
+    Metrics = std::make_shared<TuMetrics>(OutputFile.str());
+    CurrentTu = Metrics;
+  }
+  return Metrics;
+}
+
+TuMetrics::TuMetrics(std::string OutputFile)
+    : OutputFile(std::move(OutputFile)),
+      Start(std::chrono::steady_clock::now()) {}
+
+TuMetrics::~TuMetrics() {
+  if (MainFile.empty())
+    return;
+  std::string Record;
+  llvm::raw_string_ostream Stream(Record);
+  llvm::json::OStream J(Stream);
+  J.object([&] {
+    J.attribute("file", MainFile);
+    J.attribute("wall_us",
+                toMicroseconds(std::chrono::steady_clock::now() - Start));
+    J.attribute("peak_rss_kb", getPeakRss());
+    J.attributeObject("checks", [&] {
+      llvm::SmallVector<llvm::StringRef, 16> Names;
+      for (const auto &Entry : Checks)
+        Names.push_back(Entry.getKey());
+      llvm::sort(Names);
+      for (llvm::StringRef Name : Names) {
+        const CheckCounters &Counters = Checks.find(Name)->getValue();
+        J.attributeObject(Name, [&] {
+          J.attribute("register_us", toMicroseconds(Counters.RegisterTime));
+          J.attribute("callback_us", toMicroseconds(Counters.CallbackTime));
+          J.attribute("callbacks", static_cast<int64_t>(Counters.Callbacks));
+          J.attribute("fixits", static_cast<int64_t>(Counters.FixIts));
+          J.attribute("suppressed",
+                      static_cast<int64_t>(Counters.SuppressedFixes));
+        });
+      }
+    });
+  });
+  Stream << '\n';
+  Stream.flush();
+
+  // One unbuffered write per record, so that records of concurrent workers
+  // and processes appending to the same file do not interleave.
+  int FD;
+  if (llvm::sys::fs::openFileForWrite(OutputFile, FD,
+                                      llvm::sys::fs::CD_OpenAlways,
+                                      llvm::sys::fs::OF_Append))
+    return;
+  llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true, /*unbuffered=*/true);
+  OS << Record;
+}
+
+CheckCallScope::CheckCallScope(CheckCounters *Counters,
+                               std::chrono::nanoseconds CheckCounters::*Phase)
+    : Counters(Counters), Outer(ActiveCheck), Phase(Phase) {
+  if (!Counters)
+    return;
+  ActiveCheck = Counters;
+  Start = std::chrono::steady_clock::now();
+}
+
+CheckCallScope::~CheckCallScope() {
+  if (!Counters)
+    return;
+  Counters->*Phase += std::chrono::steady_clock::now() - Start;
+  ActiveCheck = Outer;
+}
+
+void noteFixIts(size_t Count) {
+  if (ActiveCheck)
+    ActiveCheck->FixIts += Count;
+}
+
+void noteSuppressedFix() {
+  if (ActiveCheck)
+    ++ActiveCheck->SuppressedFixes;
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
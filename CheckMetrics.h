@@ -0,0 +1,142 @@
+//===--- CheckMetrics.h - clang-tidy ----------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_CHECKMETRICS_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_CHECKMETRICS_H
+
+#include "clang-tidy/ClangTidyCheck.h"
+#include "llvm/ADT/StringMap.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+/// What one check cost and produced in one translation unit.
+///
+/// Only the check's own code is timed. The time MatchFinder spends running
+/// its matchers over the AST is not included; clang-tidy's
+/// -enable-check-profile reports that per check.
+struct CheckCounters {
+  std::chrono::nanoseconds RegisterTime{0};
+  /// Time in check() and onEndOfTranslationUnit().
+  std::chrono::nanoseconds CallbackTime{0};
+  /// Calls of check(), one per match of any of the check's matchers.
+  uint64_t Callbacks = 0;
+  uint64_t FixIts = 0;
+  /// Findings the check left without a fix, or dropped, because the rewrite
+  /// was not safe.
+  uint64_t SuppressedFixes = 0;
+};
+
+/// The counters of every instrumented check of one translation unit. The
+/// check instances clang-tidy creates for a TU share one object, which
+/// appends the TU's record to the metrics file as a single JSON line once the
+/// last of them is destroyed:
+///
+///   {"file":"a.cpp","wall_us":812345,"peak_rss_kb":301234,
+///    "checks":{"mir-reorder":{"register_us":3,"callback_us":140,
+///                             "callbacks":12,"fixits":2,"suppressed":0},
+///              ...}}
+class TuMetrics {
+public:
+  /// The metrics of the TU whose checks this thread is creating.
+  static std::shared_ptr<TuMetrics> getForNewCheck(llvm::StringRef OutputFile);
+
+  explicit TuMetrics(std::string OutputFile);
+  ~TuMetrics();
+
+  CheckCounters &getCounters(llvm::StringRef CheckName) {
+    return Checks[CheckName];
+  }
+
+  /// Marks the TU as being analyzed. Metrics of check instances that never
+  /// saw a TU, such as those created to dump the configuration, are not
+  /// written.
+  void setMainFile(llvm::StringRef File) { MainFile = File.str(); }
+
+private:
+  std::string OutputFile;
+  std::string MainFile;
+  std::chrono::steady_clock::time_point Start;
+  llvm::StringMap<CheckCounters> Checks;
+};
+
+/// Times one call into a check and directs noteFixIts() and
+/// noteSuppressedFix() on this thread to its counters. Does nothing when
+/// \p Counters is null.
+class CheckCallScope {
+public:
+  CheckCallScope(CheckCounters *Counters,
+                 std::chrono::nanoseconds CheckCounters::*Phase);
+  ~CheckCallScope();
+
+private:
+  CheckCounters *Counters;
+  CheckCounters *Outer;
+  std::chrono::nanoseconds CheckCounters::*Phase;
+  std::chrono::steady_clock::time_point Start;
+};
+
+/// Records that the running check attached \p Count fix-its to a diagnostic.
+void noteFixIts(size_t Count);
+
+/// Records that the running check left a finding without its fix.
+void noteSuppressedFix();
+
+/// Wraps check \p T to record its per-TU metrics when the `MetricsFile`
+/// option (local or global) names a file. Otherwise it only forwards.
+template <typename T> class InstrumentedCheck : public T {
+public:
+  InstrumentedCheck(StringRef Name, ClangTidyContext *Context)
+      : T(Name, Context) {
+    std::string File = this->Options.getLocalOrGlobal("MetricsFile", "");
+    if (!File.empty()) {
+      Metrics = TuMetrics::getForNewCheck(File);
+      Counters = &Metrics->getCounters(Name);
+    }
+  }
+
+  void registerPPCallbacks(const SourceManager &SM, Preprocessor *PP,
+                           Preprocessor *ModuleExpanderPP) override {
+    CheckCallScope Scope(Counters, &CheckCounters::RegisterTime);
+    T::registerPPCallbacks(SM, PP, ModuleExpanderPP);
+  }
+
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override {
+    CheckCallScope Scope(Counters, &CheckCounters::RegisterTime);
+    T::registerMatchers(Finder);
+    if (Metrics)
+      Metrics->setMainFile(this->getCurrentMainFile());
+  }
+
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override {
+    CheckCallScope Scope(Counters, &CheckCounters::CallbackTime);
+    if (Counters)
+      ++Counters->Callbacks;
+    T::check(Result);
+  }
+
+  void onEndOfTranslationUnit() override {
+    CheckCallScope Scope(Counters, &CheckCounters::CallbackTime);
+    T::onEndOfTranslationUnit();
+  }
+
+private:
+  std::shared_ptr<TuMetrics> Metrics;
+  CheckCounters *Counters = nullptr;
+};
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_CHECKMETRICS_H
@@ -0,0 +1,159 @@
+//===--- FileContentCache.cpp - mir-migrate -------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "FileContentCache.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+
+namespace clang {
+namespace tidy {
+namespace mir {
+namespace {
+
+/// A view of cached contents that keeps them alive while a SourceManager
+/// uses it, even once the cache has replaced or evicted them.
+class SharedBuffer : public llvm::MemoryBuffer {
+public:
+  SharedBuffer(std::shared_ptr<llvm::MemoryBuffer> Contents,
+               bool RequiresNullTerminator)
+      : Contents(std::move(Contents)) {
+    init(this->Contents->getBufferStart(), this->Contents->getBufferEnd(),
+         RequiresNullTerminator);
+  }
+
+  llvm::StringRef getBufferIdentifier() const override {
+    return Contents->getBufferIdentifier();
+  }
+
+  BufferKind getBufferKind() const override {
+    return Contents->getBufferKind();
+  }
+
+private:
+  std::shared_ptr<llvm::MemoryBuffer> Contents;
+};
+
+class CachedFile : public llvm::vfs::File {
+public:
+  CachedFile(llvm::vfs::Status Stat,
+             std::shared_ptr<llvm::MemoryBuffer> Contents)
+      : Stat(std::move(Stat)), Contents(std::move(Contents)) {}
+
+  llvm::ErrorOr<llvm::vfs::Status> status() override { return Stat; }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+  getBuffer(const llvm::Twine &Name, int64_t FileSize,
+            bool RequiresNullTerminator, bool IsVolatile) override {
+    // Cached contents are read null-terminated.
+    return std::make_unique<SharedBuffer>(Contents, RequiresNullTerminator);
+  }
+
+  std::error_code close() override { return {}; }
+
+private:
+  llvm::vfs::Status Stat;
+  std::shared_ptr<llvm::MemoryBuffer> Contents;
+};
+
+class CachingFileSystem : public llvm::vfs::ProxyFileSystem {
+public:
+  CachingFileSystem(FileContentCache &Cache,
+                    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> Base)
+      : ProxyFileSystem(std::move(Base)), Cache(Cache) {}
+
+  llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>>
+  openFileForRead(const llvm::Twine &Path) override {
+    llvm::SmallString<256> Absolute;
+    Path.toVector(Absolute);
+    if (std::error_code EC = makeAbsolute(Absolute))
+      return EC;
+    llvm::ErrorOr<llvm::vfs::Status> Stat = status(Absolute);
+    if (!Stat || !Stat->isRegularFile())
+      return ProxyFileSystem::openFileForRead(Path);
+    llvm::vfs::Status Named =
+        llvm::vfs::Status::copyWithNewName(*Stat, Path.str());
+    if (auto Contents = Cache.lookup(Absolute, *Stat))
+      return std::make_unique<CachedFile>(std::move(Named),
+                                          std::move(Contents));
+
+    auto File = ProxyFileSystem::openFileForRead(Absolute);
+    if (!File)
+      return File.getError();
+    auto Buffer = (*File)->getBuffer(Absolute, Stat->getSize(),
+                                     /*RequiresNullTerminator=*/true,
+                                     /*IsVolatile=*/false);
+    if (!Buffer)
+      return Buffer.getError();
+    std::shared_ptr<llvm::MemoryBuffer> Contents =
+        Cache.store(Absolute, *Stat, std::move(*Buffer));
+    return std::make_unique<CachedFile>(std::move(Named), std::move(Contents));
+  }
+
+private:
+  FileContentCache &Cache;
+};
+
+} // namespace
+
+llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem>
+FileContentCache::createFileSystem(
+    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> Base) {
+  return llvm::makeIntrusiveRefCnt<CachingFileSystem>(*this, std::move(Base));
+}
+
+std::shared_ptr<llvm::MemoryBuffer>
+FileContentCache::lookup(llvm::StringRef Path,
+                         const llvm::vfs::Status &Current) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto It = Entries.find(Path);
+  if (It == Entries.end() ||
+      It->second.ModificationTime != Current.getLastModificationTime() ||
+      It->second.Size != Current.getSize() ||
+      It->second.Id != Current.getUniqueID()) {
+    ++Misses;
+    return nullptr;
+  }
+  ++Hits;
+  return It->second.Contents;
+}
+
+std::shared_ptr<llvm::MemoryBuffer>
+FileContentCache::store(llvm::StringRef Path, const llvm::vfs::Status &Current,
+                        std::shared_ptr<llvm::MemoryBuffer> Contents) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  Entry &Cached = Entries[Path];
+  if (Cached.Contents &&
+      Cached.ModificationTime == Current.getLastModificationTime() &&
+      Cached.Size == Current.getSize() && Cached.Id == Current.getUniqueID())
+    return Cached.Contents;
+  Cached = {Current.getLastModificationTime(), Current.getSize(),
+            Current.getUniqueID(), std::move(Contents)};
+  return Cached.Contents;
+}
+
+std::vector<std::string> FileContentCache::revalidate() {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  std::vector<std::string> Changed;
+  for (auto &Entry : Entries) {
+    llvm::sys::fs::file_status Status;
+    if (!llvm::sys::fs::status(Entry.getKey(), Status) &&
+        Status.getLastModificationTime() == Entry.second.ModificationTime &&
+        Status.getSize() == Entry.second.Size &&
+        Status.getUniqueID() == Entry.second.Id)
+      continue;
+    Changed.push_back(Entry.getKey().str());
+  }
+  for (const std::string &Path : Changed)
+    Entries.erase(Path);
+  return Changed;
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,74 @@
+//===--- FileContentCache.h - mir-migrate -----------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_FILECONTENTCACHE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_FILECONTENTCACHE_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/FileSystem/UniqueID.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+/// Contents of the files a long-running mir-migrate -serve process has read,
+/// shared by its workers so that headers are read once rather than once per
+/// request. Every read still stats the file and only uses an entry whose
+/// modification time, size and inode are unchanged.
+class FileContentCache {
+public:
+  /// A file system that serves reads from \p Base through this cache. Each
+  /// worker needs its own, since ClangTool changes its working directory.
+  llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem>
+  createFileSystem(llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> Base);
+
+  /// Returns the cached contents of \p Path if they match \p Current, or
+  /// null.
+  std::shared_ptr<llvm::MemoryBuffer> lookup(llvm::StringRef Path,
+                                             const llvm::vfs::Status &Current);
+
+  /// Caches \p Contents as those of \p Path, unless another worker already
+  /// stored contents matching \p Current. Returns the cached contents.
+  std::shared_ptr<llvm::MemoryBuffer>
+  store(llvm::StringRef Path, const llvm::vfs::Status &Current,
+        std::shared_ptr<llvm::MemoryBuffer> Contents);
+
+  /// Stats every cached file, evicts those that changed or disappeared and
+  /// returns their paths.
+  std::vector<std::string> revalidate();
+
+  unsigned getHits() const { return Hits; }
+  unsigned getMisses() const { return Misses; }
+
+private:
+  struct Entry {
+    llvm::sys::TimePoint<> ModificationTime;
+    uint64_t Size;
+    llvm::sys::fs::UniqueID Id;
+    std::shared_ptr<llvm::MemoryBuffer> Contents;
+  };
+
+  std::mutex Mutex;
+  llvm::StringMap<Entry> Entries;
+  std::atomic<unsigned> Hits{0};
+  std::atomic<unsigned> Misses{0};
+};
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_FILECONTENTCACHE_H
@@ -0,0 +1,208 @@
+//===--- FixMerger.cpp - mir-migrate --------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "FixMerger.h"
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang/Tooling/DiagnosticsYaml.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/xxhash.h"
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+void FixMerger::addDiagnostic(const tooling::Diagnostic &Diag) {
+  const llvm::StringMap<tooling::Replacements> *Fix =
+      getFixIt(Diag, /*AnyFix=*/false);
+  if (!Fix || Fix->empty())
+    return;
+
+  // Identical diagnostics from different TUs are one fix.
+  std::string Key;
+  llvm::raw_string_ostream(Key)
+      << Diag.DiagnosticName << '\0' << Diag.Message.FilePath << '\0'
+      << Diag.Message.FileOffset << '\0' << Diag.Message.Message;
+  auto [FixIt, NewFix] = FixIds.try_emplace(Key, Fixes.size());
+  unsigned FixId = FixIt->second;
+  if (NewFix) {
+    std::string Description;
+    llvm::raw_string_ostream(Description)
+        << Diag.DiagnosticName << " at " << Diag.Message.FilePath << ':'
+        << Diag.Message.FileOffset;
+    Fixes.push_back({std::move(Description)});
+  }
+
+  for (const auto &FileAndReplacements : *Fix) {
+    for (const tooling::Replacement &R : FileAndReplacements.second) {
+      llvm::SmallString<256> Path(R.getFilePath());
+      llvm::sys::fs::make_absolute(Diag.BuildDirectory, Path);
+      llvm::sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+      auto [FileIt, NewFile] = FileIds.try_emplace(Path, Files.size());
+      if (NewFile)
+        Files.push_back({Path.str().str(), {}, {}});
+      FileEdits &File = Files[FileIt->second];
+
+      ++NumAdded;
+      llvm::StringRef Text = Texts.save(R.getReplacementText());
+      auto [EditIt, NewEdit] = File.Index.try_emplace(
+          std::make_tuple(R.getOffset(), R.getLength(), llvm::xxHash64(Text)),
+          File.Edits.size());
+      // Saved texts are unique, so equal text means equal pointers.
+      if (!NewEdit && File.Edits[EditIt->second].Text.data() == Text.data()) {
+        auto &EditFixes = File.Edits[EditIt->second].Fixes;
+        if (!llvm::is_contained(EditFixes, FixId))
+          EditFixes.push_back(FixId);
+        continue;
+      }
+      ++NumDistinct;
+      File.Edits.push_back({R.getOffset(), R.getLength(), Text, {FixId}});
+    }
+  }
+}
+
+bool FixMerger::addExportedFixes(llvm::StringRef YamlPath,
+                                 llvm::raw_ostream &Errs) {
+  auto Buffer = llvm::MemoryBuffer::getFile(YamlPath);
+  if (!Buffer) {
+    Errs << YamlPath << ": " << Buffer.getError().message() << "\n";
+    return false;
+  }
+  tooling::TranslationUnitDiagnostics Exported;
+  llvm::yaml::Input YIn((*Buffer)->getBuffer());
+  YIn >> Exported;
+  if (YIn.error()) {
+    Errs << YamlPath << ": " << YIn.error().message() << "\n";
+    return false;
+  }
+  for (const tooling::Diagnostic &Diag : Exported.Diagnostics)
+    addDiagnostic(Diag);
+  return true;
+}
+
+std::vector<FixMerger::Conflict> FixMerger::resolve() {
+  std::vector<Conflict> Conflicts;
+  for (FileEdits &File : Files) {
+    File.Index.clear();
+    llvm::sort(File.Edits, [](const Edit &A, const Edit &B) {
+      return std::make_tuple(A.Offset, A.Length, A.Text) <
+             std::make_tuple(B.Offset, B.Length, B.Text);
+    });
+    // The edit reaching furthest so far; later edits must start at or after
+    // its end, and insertions must not share its offset.
+    const Edit *Reach = nullptr;
+    for (const Edit &E : File.Edits) {
+      if (Reach && (E.Offset < Reach->Offset + Reach->Length ||
+                    (E.Offset == Reach->Offset && !E.Length &&
+                     !Reach->Length))) {
+        for (unsigned Id : Reach->Fixes)
+          Fixes[Id].Dropped = true;
+        for (unsigned Id : E.Fixes)
+          Fixes[Id].Dropped = true;
+        Conflicts.push_back({File.Path, E.Offset,
+                             Fixes[Reach->Fixes.front()].Description,
+                             Fixes[E.Fixes.front()].Description});
+      }
+      if (!Reach || E.Offset + E.Length > Reach->Offset + Reach->Length ||
+          (!E.Length && !Reach->Length))
+        Reach = &E;
+    }
+  }
+  return Conflicts;
+}
+
+bool FixMerger::isApplied(const Edit &E) const {
+  return llvm::any_of(E.Fixes, [this](unsigned Id) {
+    return !Fixes[Id].Dropped;
+  });
+}
+
+unsigned FixMerger::apply(unsigned &NumApplied,
+                          llvm::raw_ostream &Errs) const {
+  unsigned NumFailed = 0;
+  NumApplied = 0;
+  for (const FileEdits &File : Files) {
+    llvm::SmallVector<const Edit *, 16> Applied;
+    for (const Edit &E : File.Edits)
+      if (isApplied(E))
+        Applied.push_back(&E);
+    if (Applied.empty())
+      continue;
+
+    auto Fail = [&](llvm::StringRef Message) {
+      Errs << File.Path << ": " << Message << "\n";
+      ++NumFailed;
+    };
+    int InFD;
+    llvm::sys::fs::file_status Status;
+    std::error_code EC = llvm::sys::fs::openFileForRead(File.Path, InFD);
+    if (EC) {
+      Fail(EC.message());
+      continue;
+    }
+    llvm::sys::fs::file_t InFile = llvm::sys::fs::convertFDToNativeFile(InFD);
+    EC = llvm::sys::fs::status(InFD, Status);
+    uint64_t Size = Status.getSize();
+    // Empty files cannot be mapped; they only take insertions.
+    llvm::sys::fs::mapped_file_region Region;
+    if (!EC && Size)
+      Region = llvm::sys::fs::mapped_file_region(
+          InFile, llvm::sys::fs::mapped_file_region::readonly, Size, 0, EC);
+    llvm::sys::fs::closeFile(InFile);
+    if (EC) {
+      Fail(EC.message());
+      continue;
+    }
+    llvm::StringRef Original(Size ? Region.const_data() : "", Size);
+    if (Applied.back()->Offset + Applied.back()->Length > Size) {
+      Fail("replacements past the end of the file; was it changed since "
+           "the fixes were exported?");
+      continue;
+    }
+
+    int OutFD;
+    llvm::SmallString<256> TempPath;
+    if ((EC = llvm::sys::fs::createUniqueFile(File.Path + "-mir-%%%%%%",
+                                              OutFD, TempPath))) {
+      Fail(EC.message());
+      continue;
+    }
+    {
+      llvm::raw_fd_ostream OS(OutFD, /*shouldClose=*/true);
+      unsigned Pos = 0;
+      for (const Edit *E : Applied) {
+        OS << Original.slice(Pos, E->Offset) << E->Text;
+        Pos = E->Offset + E->Length;
+      }
+      OS << Original.substr(Pos);
+      OS.close();
+      EC = OS.error();
+      OS.clear_error();
+    }
+    if (!EC)
+      EC = llvm::sys::fs::setPermissions(TempPath, Status.permissions());
+    if (!EC)
+      EC = llvm::sys::fs::rename(TempPath, File.Path);
+    if (EC) {
+      llvm::sys::fs::remove(TempPath);
+      Fail(EC.message());
+      continue;
+    }
+    NumApplied += Applied.size();
+  }
+  return NumFailed;
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,103 @@
+//===--- FixMerger.h - mir-migrate ------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_FIXMERGER_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_FIXMERGER_H
+
+#include "clang/Tooling/Core/Diagnostic.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+/// Merges the fixes of any number of translation units, fed one diagnostic
+/// or one exported YAML file at a time, and rewrites every touched file once.
+///
+/// A replacement is kept once per (file, offset, length, text hash), so a
+/// header fix reported by hundreds of TUs costs as much memory as one. Two
+/// distinct replacements conflict when they overlap or insert different text
+/// at the same offset; every fix that contributed one of them is dropped as a
+/// whole, in every file, so that no fix is half applied.
+class FixMerger {
+public:
+  struct Conflict {
+    std::string File;
+    unsigned Offset;
+    /// The diagnostics whose fixes were dropped, as `check at file:offset`.
+    std::string First;
+    std::string Second;
+  };
+
+  /// Adds the fix clang-tidy -fix would apply for \p Diag. Relative paths are
+  /// resolved against its build directory.
+  void addDiagnostic(const tooling::Diagnostic &Diag);
+
+  /// Streams the diagnostics of a clang-tidy -export-fixes file into the
+  /// merger; only its distinct replacements stay in memory.
+  bool addExportedFixes(llvm::StringRef YamlPath, llvm::raw_ostream &Errs);
+
+  /// Detects the conflicts among everything added so far and drops the
+  /// fixes involved. Call once, before apply().
+  std::vector<Conflict> resolve();
+
+  /// Rewrites every file with replacements of a surviving fix: the original
+  /// is memory-mapped and streamed with the replacements spliced in to a
+  /// temporary file, which is then renamed over it. Returns the number of
+  /// files that could not be rewritten; \p NumApplied counts replacements.
+  unsigned apply(unsigned &NumApplied, llvm::raw_ostream &Errs) const;
+
+  /// Replacements added, duplicates included.
+  uint64_t getNumAdded() const { return NumAdded; }
+  unsigned getNumDistinct() const { return NumDistinct; }
+
+private:
+  struct Edit {
+    unsigned Offset;
+    unsigned Length;
+    llvm::StringRef Text;
+    /// The fixes that produced this replacement.
+    llvm::SmallVector<unsigned, 1> Fixes;
+  };
+
+  struct FileEdits {
+    std::string Path;
+    std::vector<Edit> Edits;
+    llvm::DenseMap<std::tuple<unsigned, unsigned, uint64_t>, unsigned> Index;
+  };
+
+  struct FixInfo {
+    std::string Description;
+    bool Dropped = false;
+  };
+
+  bool isApplied(const Edit &E) const;
+
+  llvm::BumpPtrAllocator Arena;
+  llvm::UniqueStringSaver Texts{Arena};
+  llvm::StringMap<unsigned> FileIds;
+  std::vector<FileEdits> Files;
+  llvm::StringMap<unsigned> FixIds;
+  std::vector<FixInfo> Fixes;
+  uint64_t NumAdded = 0;
+  unsigned NumDistinct = 0;
+};
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_FIXMERGER_H
@@ -0,0 +1,200 @@
+//===--- FormatStringBuilder.cpp - clang-tidy -----------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "FormatStringBuilder.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/ExprCXX.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Format.h"
+#include "utils.hpp"
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+namespace {
+
+bool isEndl(const Expr &A) {
+  const auto *DeclRef = llvm::dyn_cast<DeclRefExpr>(A.IgnoreParenImpCasts());
+  if (!DeclRef)
+    return false;
+  const auto *Ident = DeclRef->getDecl()->getIdentifier();
+  return Ident && Ident->isStr("endl");
+}
+
+bool isStdString(QualType T) {
+  const auto *Record = T->getAsCXXRecordDecl();
+  return Record && Record->isInStdNamespace() && Record->getIdentifier() &&
+         Record->getName() == "basic_string";
+}
+
+/// The narrow literal an operand prints: `"..."`, `std::string("...")` or
+/// `"..."s`. Literals with embedded NULs are not folded; the stream would
+/// stop at the first one for some spellings and not for others.
+const StringLiteral *getFoldableString(const Expr &A) {
+  const Expr *E = A.IgnoreImplicit();
+  if (const auto *Udl = llvm::dyn_cast<UserDefinedLiteral>(E)) {
+    const FunctionDecl *Op = Udl->getDirectCallee();
+    if (Udl->getLiteralOperatorKind() == UserDefinedLiteral::LOK_String &&
+        Udl->getUDSuffix()->isStr("s") && Op && Op->isInStdNamespace())
+      E = Udl->getCookedLiteral()->IgnoreImplicit();
+  } else if (const auto *Cast = llvm::dyn_cast<CXXFunctionalCastExpr>(E)) {
+    const auto *Construct =
+        llvm::dyn_cast<CXXConstructExpr>(Cast->getSubExpr()->IgnoreImplicit());
+    if (Construct && isStdString(Construct->getType()) &&
+        Construct->getNumArgs() >= 1 &&
+        (Construct->getNumArgs() == 1 ||
+         llvm::isa<CXXDefaultArgExpr>(Construct->getArg(1))))
+      E = Construct->getArg(0)->IgnoreImplicit();
+  }
+  const auto *Lit = llvm::dyn_cast<StringLiteral>(E);
+  if (!Lit || Lit->getCharByteWidth() != 1 || Lit->getString().contains('\0'))
+    return nullptr;
+  return Lit;
+}
+
+/// Folds a literal operand, possibly negated, into the format text as the
+/// stream would print it. \p A carries the type of the operator<< overload
+/// that prints it.
+bool foldConstant(const Expr &A, const ASTContext &Ctx,
+                  FormatStringBuilder &FSB) {
+  QualType T = A.getType();
+  const Expr *E = A.IgnoreParenImpCasts();
+  if (const auto *Neg = llvm::dyn_cast<UnaryOperator>(E))
+    if (Neg->getOpcode() == UO_Minus)
+      E = Neg->getSubExpr()->IgnoreParenImpCasts();
+  if (const auto *Char =
+          llvm::dyn_cast<CharacterLiteral>(A.IgnoreParenImpCasts())) {
+    if (!T->isCharType())
+      return false;
+    char C = static_cast<char>(Char->getValue());
+    FSB.addTextCopy(StringRef(&C, 1));
+    return true;
+  }
+  if (const auto *Bool = llvm::dyn_cast<CXXBoolLiteralExpr>(E)) {
+    if (!T->isBooleanType())
+      return false;
+    FSB.addText(Bool->getValue() ? "1" : "0");
+    return true;
+  }
+  if (llvm::isa<IntegerLiteral>(E)) {
+    Expr::EvalResult Value;
+    if (!T->isIntegerType() || T->isAnyCharacterType() || T->isBooleanType() ||
+        T->isEnumeralType() || !A.EvaluateAsInt(Value, Ctx))
+      return false;
+    FSB.addInteger(Value.Val.getInt());
+    return true;
+  }
+  if (llvm::isa<FloatingLiteral>(E)) {
+    llvm::APFloat Value(0.0);
+    return T->isRealFloatingType() && A.EvaluateAsFloat(Value, Ctx) &&
+           FSB.addFloating(Value);
+  }
+  return false;
+}
+
+} // namespace
+
+bool isStreamManipulator(const Expr &Operand) {
+  QualType T = Operand.IgnoreParenImpCasts()->getType();
+  if (T->isFunctionType() || T->isFunctionPointerType() ||
+      T->isFunctionReferenceType())
+    return true;
+  // libstdc++ spells the setters' results as reserved std:: class names.
+  const auto *Record = T->getAsCXXRecordDecl();
+  return Record && Record->isInStdNamespace() && Record->getIdentifier() &&
+         Record->getName().startswith("_");
+}
+
+void FormatStringBuilder::addStringLiteral(const StringLiteral &Sl) {
+  if (Sl.getCharByteWidth() != 1) {
+    addFormatExpr(Sl);
+    return;
+  }
+  addText(Sl.getString());
+}
+
+void FormatStringBuilder::addInteger(const llvm::APSInt &Value) {
+  // The stream prints the value in decimal whatever the literal's spelling.
+  llvm::SmallString<24> Text;
+  Value.toString(Text, 10);
+  addTextCopy(Text);
+}
+
+bool FormatStringBuilder::addFloating(const llvm::APFloat &Value) {
+  // A stream with default flags and precision formats like "%g".
+  double D;
+  if (&Value.getSemantics() == &llvm::APFloat::IEEEdouble())
+    D = Value.convertToDouble();
+  else if (&Value.getSemantics() == &llvm::APFloat::IEEEsingle())
+    D = Value.convertToFloat();
+  else
+    return false;
+  llvm::SmallString<32> Text;
+  llvm::raw_svector_ostream(Text) << llvm::format("%g", D);
+  addTextCopy(Text);
+  return true;
+}
+
+void FormatStringBuilder::addFormatExpr(const Expr &Ex, StringRef Spec) {
+  StringRef Placeholder =
+      Spec.empty() ? StringRef("{}") : Saver.save("{:" + Spec + "}");
+  FmtStringComponents.push_back({Placeholder, true});
+  FmtArgsComponents.push_back(getExprAsString(Sm, Ex));
+}
+
+void FormatStringBuilder::addStreamOperands(
+    llvm::ArrayRef<const Expr *> Operands, const ASTContext &Ctx) {
+  bool FoldConstants = llvm::none_of(Operands, [](const Expr *Operand) {
+    return isStreamManipulator(*Operand) && !isEndl(*Operand);
+  });
+  for (const Expr *Operand : Operands) {
+    if (isEndl(*Operand))
+      continue;
+    if (const auto *Lit = getFoldableString(*Operand))
+      addStringLiteral(*Lit);
+    else if (!FoldConstants || !foldConstant(*Operand, Ctx, *this))
+      addFormatExpr(*Operand);
+  }
+}
+
+void FormatStringBuilder::writeTo(llvm::raw_ostream &Os) const {
+  Os << "ROSFMT_" << Logger.Level << Logger.Variant << "(";
+  for (StringRef Arg : Logger.LeadingArgs) {
+    Os << Arg << ",";
+  }
+  if (!FormatWrapper.empty())
+    Os << FormatWrapper << "(";
+  Os << "\"";
+  for (const auto &Fmt : FmtStringComponents) {
+    if (Fmt.IsPlaceholder)
+      Os << Fmt.Text;
+    else
+      writeEscapedLiteral(Os, Fmt.Text, /*EscapeBraces=*/true);
+  }
+  Os << "\"";
+  if (!FormatWrapper.empty())
+    Os << ")";
+  for (StringRef Arg : FmtArgsComponents) {
+    Os << "," << Arg;
+  }
+  Os << ")";
+}
+
+StringRef
+FormatStringBuilder::getFormatString(llvm::SmallVectorImpl<char> &Out) const {
+  Out.clear();
+  llvm::raw_svector_ostream Os(Out);
+  writeTo(Os);
+  return Os.str();
+}
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
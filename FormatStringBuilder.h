@@ -0,0 +1,84 @@
+//===--- FormatStringBuilder.h - clang-tidy ---------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_FORMATSTRINGBUILDER_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_FORMATSTRINGBUILDER_H
+
+#include "RosLogMacros.h"
+#include "clang/AST/Expr.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/APSInt.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+/// std::hex, std::setw(2), std::endl and the like: operands that act on the
+/// stream rather than print a value.
+bool isStreamManipulator(const Expr &Operand);
+
+/// Collects the pieces of a ROSFMT_* call as slices of the AST and source
+/// buffers; only text folded into the format string and placeholders with a
+/// format spec are synthesized, and those go to the check's per-TU arena.
+class FormatStringBuilder {
+public:
+  FormatStringBuilder(const SourceManager &Sm, llvm::StringSaver &Saver,
+                      const LogExpansion &Logger)
+      : Logger(Logger), Sm(Sm), Saver(Saver) {}
+
+  /// Literal text; braces are escaped when the call is written.
+  void addText(StringRef Text) { FmtStringComponents.push_back({Text, false}); }
+  /// Literal text built on the fly; copied into the arena.
+  void addTextCopy(const llvm::Twine &Text) { addText(Saver.save(Text)); }
+  void addStringLiteral(const StringLiteral &Sl);
+  /// Folds a constant as a stream would print it: integers in decimal,
+  /// floating-point values like "%g". Returns false for formats other than
+  /// float and double.
+  void addInteger(const llvm::APSInt &Value);
+  bool addFloating(const llvm::APFloat &Value);
+
+  /// A placeholder for \p Ex, spelled as in the source. \p Spec is the fmt
+  /// format spec without the colon; empty gives "{}".
+  void addFormatExpr(const Expr &Ex, StringRef Spec = {});
+
+  /// The operands of a `<<` chain into a fresh stream, in order. Literals are
+  /// folded into the format text as the stream would print them, unless a
+  /// manipulator changes the stream's formatting; `std::endl` is dropped.
+  void addStreamOperands(llvm::ArrayRef<const Expr *> Operands,
+                         const ASTContext &Ctx);
+
+  /// Wraps the format string in \p Macro (FMT_STRING, FMT_COMPILE) so fmt
+  /// parses and checks it at compile time.
+  void setFormatWrapper(StringRef Macro) { FormatWrapper = Macro; }
+
+  void writeTo(llvm::raw_ostream &Os) const;
+  StringRef getFormatString(llvm::SmallVectorImpl<char> &Out) const;
+
+private:
+  struct FmtComponent {
+    StringRef Text;
+    bool IsPlaceholder;
+  };
+
+  const LogExpansion &Logger;
+  const SourceManager &Sm;
+  llvm::StringSaver &Saver;
+  StringRef FormatWrapper;
+  llvm::SmallVector<FmtComponent, 16> FmtStringComponents;
+  llvm::SmallVector<StringRef, 8> FmtArgsComponents;
+};
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_FORMATSTRINGBUILDER_H
@@ -0,0 +1,306 @@
+//===--- HeaderGuardScanner.cpp - mir-migrate -----------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "HeaderGuardScanner.h"
+
+#include "clang/Basic/LangOptions.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Tooling/Core/Replacement.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include <algorithm>
+#include <tuple>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+namespace {
+
+constexpr llvm::StringLiteral CheckName = "mir-headercheck";
+
+/// The parts of a header's directive structure that guard checking needs.
+/// Offsets are into the file buffer.
+struct GuardInfo {
+  bool PragmaOnce = false;
+  /// Set when the file opens with `#ifndef X` directly followed by
+  /// `#define X` and ends with the matching `#endif`, without an `#else` or
+  /// `#elif` in between: the shape the preprocessor accepts as a header guard.
+  StringRef Guard;
+  unsigned IfndefOffset = 0;
+  unsigned DefineOffset = 0;
+  /// The `endif` token closing the guard's `#ifndef`.
+  llvm::Optional<unsigned> EndifOffset;
+  /// Every `#define`d macro name and its offset.
+  llvm::SmallVector<std::pair<StringRef, unsigned>, 8> Defines;
+};
+
+const LangOptions &getLexLangOptions() {
+  static const LangOptions Opts = [] {
+    LangOptions Opts;
+    Opts.CPlusPlus = true;
+    Opts.LineComment = true;
+    return Opts;
+  }();
+  return Opts;
+}
+
+class DirectiveLexer {
+public:
+  explicit DirectiveLexer(StringRef Buffer)
+      : Lex(SourceLocation(), getLexLangOptions(), Buffer.begin(),
+            Buffer.begin(), Buffer.end()) {
+    next();
+  }
+
+  const Token &token() const { return Tok; }
+  unsigned offset() const { return Offset; }
+  bool atEof() const { return Tok.is(tok::eof); }
+  bool atLineStart() const { return atEof() || Tok.isAtStartOfLine(); }
+  StringRef identifier() const {
+    return Tok.is(tok::raw_identifier) ? Tok.getRawIdentifier() : StringRef();
+  }
+
+  void next() {
+    Lex.LexFromRawLexer(Tok);
+    Offset = Lex.getCurrentBufferOffset() - Tok.getLength();
+  }
+  /// Advances within the current directive; false at the end of the line.
+  bool nextInLine() {
+    next();
+    return !atLineStart();
+  }
+  void skipLine() {
+    while (!atLineStart())
+      next();
+  }
+
+private:
+  Lexer Lex;
+  Token Tok;
+  unsigned Offset = 0;
+};
+
+GuardInfo scanDirectives(StringRef Buffer) {
+  GuardInfo Info;
+  DirectiveLexer L(Buffer);
+  bool AtFileStart = true;
+  bool ExpectGuardDefine = false;
+  StringRef Candidate;
+  unsigned CandidateOffset = 0;
+  unsigned Depth = 0;
+  bool GuardBroken = false;
+  while (!L.atEof()) {
+    // Anything after the guard's #endif is outside of it.
+    if (Info.EndifOffset) {
+      GuardBroken = true;
+      break;
+    }
+    if (!L.token().is(tok::hash) || !L.token().isAtStartOfLine()) {
+      AtFileStart = ExpectGuardDefine = false;
+      L.next();
+      continue;
+    }
+    bool FirstDirective = AtFileStart;
+    bool FollowsGuardIfndef = ExpectGuardDefine;
+    AtFileStart = ExpectGuardDefine = false;
+    if (!L.nextInLine())
+      continue;
+    StringRef Directive = L.identifier();
+    unsigned DirectiveOffset = L.offset();
+    if (Directive == "if" || Directive == "ifdef" || Directive == "ifndef") {
+      ++Depth;
+      if (Directive == "ifndef" && FirstDirective && L.nextInLine() &&
+          !L.identifier().empty()) {
+        Candidate = L.identifier();
+        CandidateOffset = L.offset();
+        ExpectGuardDefine = true;
+      }
+    } else if (Directive == "else" || Directive.startswith("elif")) {
+      if (Depth == 1 && !Info.Guard.empty())
+        GuardBroken = true;
+    } else if (Directive == "endif") {
+      if (Depth == 1 && !Info.Guard.empty() && !Info.EndifOffset)
+        Info.EndifOffset = DirectiveOffset;
+      if (Depth)
+        --Depth;
+    } else if (Directive == "define") {
+      if (L.nextInLine() && !L.identifier().empty()) {
+        Info.Defines.push_back({L.identifier(), L.offset()});
+        if (FollowsGuardIfndef && L.identifier() == Candidate) {
+          Info.Guard = Candidate;
+          Info.IfndefOffset = CandidateOffset;
+          Info.DefineOffset = L.offset();
+        }
+      }
+    } else if (Directive == "pragma") {
+      if (L.nextInLine() && L.identifier() == "once")
+        Info.PragmaOnce = true;
+    }
+    L.skipLine();
+  }
+  if (GuardBroken || !Info.EndifOffset)
+    Info.Guard = StringRef();
+  return Info;
+}
+
+/// Mirrors HeaderGuardCheck's wouldFixEndifComment for a header file.
+bool wouldFixEndifComment(StringRef Buffer, llvm::Optional<unsigned> EndIf,
+                          StringRef HeaderGuard, size_t *EndIfLenPtr = nullptr) {
+  if (!EndIf)
+    return false;
+  StringRef EndIfStr = Buffer.substr(*EndIf);
+  size_t EndIfLen = std::min(EndIfStr.find_first_of("\r\n"), EndIfStr.size());
+  if (EndIfLenPtr)
+    *EndIfLenPtr = EndIfLen;
+  EndIfStr = EndIfStr.substr(0, EndIfLen);
+  EndIfStr = EndIfStr.substr(EndIfStr.find_first_not_of("#endif \t"));
+
+  // Give up if there's an escaped newline.
+  size_t FindEscapedNewline = EndIfStr.find_last_not_of(' ');
+  if (FindEscapedNewline != StringRef::npos &&
+      EndIfStr[FindEscapedNewline] == '\\')
+    return false;
+
+  bool IsLineComment =
+      EndIfStr.consume_front("//") ||
+      (EndIfStr.consume_front("/*") && EndIfStr.consume_back("*/"));
+  if (!IsLineComment)
+    return true;
+  return EndIfStr.trim() != HeaderGuard;
+}
+
+std::string formatEndIf(StringRef HeaderGuard) {
+  return "endif // " + HeaderGuard.str();
+}
+
+void addFix(ClangTidyError &Error, unsigned Offset, unsigned Length,
+            StringRef Text) {
+  const std::string &FilePath = Error.Message.FilePath;
+  tooling::Replacement Replacement(FilePath, Offset, Length, Text);
+  if (llvm::Error Err = Error.Message.Fix[FilePath].add(Replacement)) {
+    llvm::errs() << "Fix conflicts with existing fix! "
+                 << llvm::toString(std::move(Err)) << "\n";
+  }
+}
+
+} // namespace
+
+void HeaderGuardScanner::scan(StringRef File,
+                              std::vector<ClangTidyError> &Errors) {
+  Context.setCurrentFile(File);
+  if (!Context.isCheckEnabled(CheckName))
+    return;
+
+  const ClangTidyOptions::OptionMap &CheckOptions =
+      Context.getOptions().CheckOptions;
+  auto GetOption = [&](StringRef Name, StringRef Default) -> StringRef {
+    auto It = CheckOptions.find((CheckName + "." + Name).str());
+    if (It != CheckOptions.end())
+      return It->second.Value;
+    return Default;
+  };
+  StringRef GlobalExtensions = utils::defaultHeaderFileExtensions();
+  auto Global = CheckOptions.find("HeaderFileExtensions");
+  if (Global != CheckOptions.end())
+    GlobalExtensions = Global->second.Value;
+  auto ExtensionsIt =
+      Extensions.try_emplace(GetOption("HeaderFileExtensions", GlobalExtensions))
+          .first;
+  if (ExtensionsIt->second.empty() &&
+      !utils::parseFileExtensions(ExtensionsIt->getKey(), ExtensionsIt->second,
+                                  utils::defaultFileExtensionDelimiters()))
+    return;
+  if (!utils::isFileExtension(File, ExtensionsIt->second))
+    return;
+
+  StringRef ProjectRoot = GetOption("ProjectRoot", myplugin::DefaultProjectRoot);
+  auto &Style = Styles[ProjectRoot];
+  if (!Style)
+    Style = std::make_unique<myplugin::HeaderGuardStyle>(ProjectRoot.str());
+
+  auto Buffer = llvm::MemoryBuffer::getFile(File);
+  if (!Buffer)
+    return;
+  StringRef Code = (*Buffer)->getBuffer();
+  GuardInfo Info = scanDirectives(Code);
+
+  auto MakeError = [&](StringRef Message, unsigned Offset) -> ClangTidyError & {
+    Errors.emplace_back(CheckName, ClangTidyError::Warning, BuildDirectory,
+                        Context.treatAsError(CheckName));
+    ClangTidyError &Error = Errors.back();
+    Error.Message.Message = Message.str();
+    Error.Message.FilePath = File.str();
+    Error.Message.FileOffset = Offset;
+    return Error;
+  };
+
+  const std::string &CPPVar = Style->getHeaderGuard(File);
+  std::string CPPVarUnder = CPPVar + '_';
+
+  if (!Info.Guard.empty()) {
+    StringRef CurHeaderGuard = Info.Guard;
+    StringRef NewGuard = CurHeaderGuard;
+    llvm::SmallVector<std::tuple<unsigned, unsigned, std::string>, 3> FixIts;
+    // Allow a trailing underscore if and only if we don't have to change the
+    // endif comment too.
+    if (CurHeaderGuard != CPPVar &&
+        (CurHeaderGuard != CPPVarUnder ||
+         wouldFixEndifComment(Code, Info.EndifOffset, CurHeaderGuard))) {
+      FixIts.emplace_back(Info.IfndefOffset, CurHeaderGuard.size(), CPPVar);
+      FixIts.emplace_back(Info.DefineOffset, CurHeaderGuard.size(), CPPVar);
+      NewGuard = CPPVar;
+    }
+    size_t EndIfLen = 0;
+    if (wouldFixEndifComment(Code, Info.EndifOffset, NewGuard, &EndIfLen))
+      FixIts.emplace_back(*Info.EndifOffset, EndIfLen, formatEndIf(NewGuard));
+    if (FixIts.empty())
+      return;
+    ClangTidyError &Error =
+        CurHeaderGuard != NewGuard
+            ? MakeError("header guard does not follow preferred style",
+                        Info.IfndefOffset)
+            : MakeError("#endif for a header guard should reference the "
+                        "guard macro in a comment",
+                        *Info.EndifOffset);
+    for (const auto &[Offset, Length, Text] : FixIts)
+      addFix(Error, Offset, Length, Text);
+    return;
+  }
+
+  if (Info.PragmaOnce)
+    return;
+
+  // A macro named like the guard that the preprocessor would not accept as
+  // one means there is code outside of the guarded area.
+  for (const auto &[Name, Offset] : Info.Defines) {
+    if (Name == CPPVar || Name == CPPVarUnder) {
+      MakeError("code/includes outside of area guarded by header guard; "
+                "consider moving it",
+                Offset);
+      return;
+    }
+  }
+
+  std::string Open = "#ifndef " + CPPVar + "\n#define " + CPPVar + "\n\n";
+  std::string Close = "\n#" + formatEndIf(CPPVar) + "\n";
+  ClangTidyError &Error = MakeError("header is missing header guard", 0);
+  // Two insertions at the same offset would conflict.
+  if (Code.empty()) {
+    addFix(Error, 0, 0, Open + Close);
+  } else {
+    addFix(Error, 0, 0, Open);
+    addFix(Error, Code.size(), 0, Close);
+  }
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
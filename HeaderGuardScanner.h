@@ -0,0 +1,51 @@
+//===--- HeaderGuardScanner.h - mir-migrate ---------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_HEADERGUARDSCANNER_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_HEADERGUARDSCANNER_H
+
+#include "HeaderincludeguardCheck.h"
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang-tidy/utils/FileExtensionsUtils.h"
+#include "llvm/ADT/StringMap.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+/// Runs mir-headercheck on a header by raw-lexing it on its own, without a
+/// translation unit. Emits the diagnostics and fix-its the check would emit
+/// when the header is reached through an include, honouring the check's
+/// ProjectRoot and HeaderFileExtensions options for the header's directory.
+///
+/// Not thread-safe; use one scanner (and context) per thread.
+class HeaderGuardScanner {
+public:
+  HeaderGuardScanner(ClangTidyContext &Context, std::string BuildDirectory)
+      : Context(Context), BuildDirectory(std::move(BuildDirectory)) {}
+
+  /// Checks \p File if it has a header extension and mir-headercheck is
+  /// enabled for it, appending diagnostics to \p Errors.
+  void scan(StringRef File, std::vector<ClangTidyError> &Errors);
+
+private:
+  ClangTidyContext &Context;
+  std::string BuildDirectory;
+  /// Keyed by the raw option value, which the parsed sets point into.
+  llvm::StringMap<utils::FileExtensionsSet> Extensions;
+  llvm::StringMap<std::unique_ptr<myplugin::HeaderGuardStyle>> Styles;
+};
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_HEADERGUARDSCANNER_H
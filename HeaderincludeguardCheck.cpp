@@ -2,12 +2,11 @@
 
 namespace myplugin {
 
-MyHeaderGuardCheck::MyHeaderGuardCheck(clang::StringRef Name,
-                                       clang::tidy::ClangTidyContext *Context)
-    : clang::tidy::utils::HeaderGuardCheck(Name, Context) {}
+const std::string &HeaderGuardStyle::getHeaderGuard(clang::StringRef Filename) {
+  auto [It, Inserted] = Guards.try_emplace(Filename);
+  if (!Inserted)
+    return It->second;
 
-std::string MyHeaderGuardCheck::getHeaderGuard(clang::StringRef Filename,
-                                               clang::StringRef OldGuard) {
   // from llvms implementation
   std::string Guard = Filename.str();
 
@@ -15,14 +14,32 @@ std::string MyHeaderGuardCheck::getHeaderGuard(clang::StringRef Filename,
   // `\` to `/`.
   Guard = llvm::sys::path::convert_to_slash(Guard);
 
-  // Find the project root make this configurable from settings?
-  size_t PosProjectRoot = Guard.rfind("external-tidy-module");
+  // Find the project root
+  size_t PosProjectRoot =
+      ProjectRoot.empty() ? clang::StringRef::npos : Guard.rfind(ProjectRoot);
   if (PosProjectRoot != clang::StringRef::npos)
     Guard = Guard.substr(PosProjectRoot);
 
   std::replace(Guard.begin(), Guard.end(), '/', '_');
   std::replace(Guard.begin(), Guard.end(), '.', '_');
   std::replace(Guard.begin(), Guard.end(), '-', '_');
-  return clang::StringRef(Guard).upper();
+  It->second = clang::StringRef(Guard).upper();
+  return It->second;
+}
+
+MyHeaderGuardCheck::MyHeaderGuardCheck(clang::StringRef Name,
+                                       clang::tidy::ClangTidyContext *Context)
+    : clang::tidy::utils::HeaderGuardCheck(Name, Context),
+      Style(Options.get("ProjectRoot", DefaultProjectRoot)) {}
+
+void MyHeaderGuardCheck::storeOptions(
+    clang::tidy::ClangTidyOptions::OptionMap &Opts) {
+  clang::tidy::utils::HeaderGuardCheck::storeOptions(Opts);
+  Options.store(Opts, "ProjectRoot", Style.getProjectRoot());
+}
+
+std::string MyHeaderGuardCheck::getHeaderGuard(clang::StringRef Filename,
+                                               clang::StringRef OldGuard) {
+  return Style.getHeaderGuard(Filename);
 }
 } // namespace myplugin
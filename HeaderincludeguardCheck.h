@@ -2,16 +2,41 @@
 #define HEADER_INCLUDE_GUARD_CHECK_H_
 
 #include <clang-tidy/utils/HeaderGuard.h>
+#include <llvm/ADT/StringMap.h>
 
 namespace myplugin {
+
+/// Default for the ProjectRoot option: guards are derived from the part of
+/// the path starting at the last occurrence of this directory name.
+constexpr const char *DefaultProjectRoot = "external-tidy-module";
+
+/// Path-to-guard computation of mir-headercheck, memoized per path. Shared
+/// with mir-migrate's lexer-only header guard mode.
+class HeaderGuardStyle {
+public:
+  explicit HeaderGuardStyle(std::string ProjectRoot)
+      : ProjectRoot(std::move(ProjectRoot)) {}
+
+  const std::string &getHeaderGuard(clang::StringRef Filename);
+  clang::StringRef getProjectRoot() const { return ProjectRoot; }
+
+private:
+  std::string ProjectRoot;
+  llvm::StringMap<std::string> Guards;
+};
+
 class MyHeaderGuardCheck : public clang::tidy::utils::HeaderGuardCheck {
 public:
   MyHeaderGuardCheck(clang::StringRef Name,
                      clang::tidy::ClangTidyContext *Context);
 
+  void storeOptions(clang::tidy::ClangTidyOptions::OptionMap &Opts) override;
   std::string
   getHeaderGuard(clang::StringRef Filename,
                  clang::StringRef OldGuard = clang::StringRef()) override;
+
+private:
+  HeaderGuardStyle Style;
 };
 } // namespace myplugin
 
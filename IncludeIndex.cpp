@@ -0,0 +1,317 @@
+//===--- IncludeIndex.cpp - mir-migrate -----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "IncludeIndex.h"
+
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <cstring>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+using llvm::support::little64_t;
+using llvm::support::ulittle32_t;
+using llvm::support::ulittle64_t;
+
+static constexpr char Magic[8] = {'M', 'I', 'R', 'I', 'D', 'X', '0', '1'};
+
+struct IncludeIndex::Header {
+  char Magic[8];
+  ulittle32_t NumFiles;
+  ulittle32_t NumTus;
+  ulittle32_t NumDeps;
+  ulittle32_t Reserved;
+  ulittle64_t StringBytes;
+};
+
+struct IncludeIndex::FileRecord {
+  ulittle32_t NameOffset;
+  ulittle32_t NameLength;
+  ulittle64_t Size;
+  little64_t MTime;
+  ulittle64_t Hash;
+};
+
+struct IncludeIndex::TuRecord {
+  ulittle32_t File;
+  ulittle32_t FirstDep;
+  ulittle32_t NumDeps;
+  ulittle32_t Reserved;
+  ulittle64_t CommandHash;
+};
+
+static_assert(sizeof(IncludeIndex::Header) == 32, "unexpected padding");
+static_assert(sizeof(IncludeIndex::FileRecord) == 32, "unexpected padding");
+static_assert(sizeof(IncludeIndex::TuRecord) == 24, "unexpected padding");
+
+static bool statFile(StringRef Path, uint64_t &Size, int64_t &MTime) {
+  llvm::sys::fs::file_status Status;
+  if (llvm::sys::fs::status(Path, Status))
+    return false;
+  Size = Status.getSize();
+  MTime = Status.getLastModificationTime().time_since_epoch().count();
+  return true;
+}
+
+static bool hashFile(StringRef Path, uint64_t &Hash) {
+  auto Buffer = llvm::MemoryBuffer::getFile(Path, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return false;
+  Hash = llvm::xxHash64((*Buffer)->getBuffer());
+  return true;
+}
+
+IncludeIndex IncludeIndex::load(StringRef Path) {
+  IncludeIndex Index;
+  auto Buffer = llvm::MemoryBuffer::getFile(Path, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return Index;
+  StringRef Data = (*Buffer)->getBuffer();
+  if (Data.size() < sizeof(Header))
+    return Index;
+  const auto *H = reinterpret_cast<const Header *>(Data.data());
+  if (std::memcmp(H->Magic, Magic, sizeof(Magic)) != 0)
+    return Index;
+  uint64_t NumFiles = H->NumFiles, NumTus = H->NumTus, NumDeps = H->NumDeps;
+  uint64_t Expected = sizeof(Header) + NumFiles * sizeof(FileRecord) +
+                      NumTus * sizeof(TuRecord) +
+                      NumDeps * sizeof(ulittle32_t) + H->StringBytes;
+  if (Data.size() != Expected)
+    return Index;
+
+  const char *Pos = Data.data() + sizeof(Header);
+  const auto *Files = reinterpret_cast<const FileRecord *>(Pos);
+  Pos += NumFiles * sizeof(FileRecord);
+  const auto *Tus = reinterpret_cast<const TuRecord *>(Pos);
+  Pos += NumTus * sizeof(TuRecord);
+  const auto *Deps = reinterpret_cast<const ulittle32_t *>(Pos);
+  Pos += NumDeps * sizeof(ulittle32_t);
+  StringRef Strings(Pos, H->StringBytes);
+
+  for (uint64_t I = 0; I < NumFiles; ++I)
+    if (uint64_t(Files[I].NameOffset) + Files[I].NameLength > Strings.size())
+      return Index;
+  for (uint64_t I = 0; I < NumTus; ++I)
+    if (Tus[I].File >= NumFiles ||
+        uint64_t(Tus[I].FirstDep) + Tus[I].NumDeps > NumDeps)
+      return Index;
+  for (uint64_t I = 0; I < NumDeps; ++I)
+    if (Deps[I] >= NumFiles)
+      return Index;
+
+  Index.Buffer = std::move(*Buffer);
+  Index.Files = Files;
+  Index.Tus = Tus;
+  Index.Deps = Deps;
+  Index.Strings = Strings;
+  for (uint32_t I = 0; I < NumFiles; ++I)
+    Index.FileIndex[Index.getFileName(I)] = I;
+  for (uint32_t I = 0; I < NumTus; ++I)
+    Index.TuIndex[Index.getFileName(Tus[I].File)] = I;
+  Index.NumTus = NumTus;
+  Index.FileState.assign(NumFiles, 0);
+  return Index;
+}
+
+uint64_t IncludeIndex::hashCommands(
+    const std::vector<tooling::CompileCommand> &Commands) {
+  std::string Key;
+  for (const auto &Command : Commands) {
+    Key += Command.Directory;
+    Key += '\0';
+    for (const auto &Arg : Command.CommandLine) {
+      Key += Arg;
+      Key += '\0';
+    }
+  }
+  return llvm::xxHash64(Key);
+}
+
+StringRef IncludeIndex::getString(uint32_t Offset, uint32_t Length) const {
+  return Strings.substr(Offset, Length);
+}
+
+StringRef IncludeIndex::getFileName(uint32_t FileIdx) const {
+  return getString(Files[FileIdx].NameOffset, Files[FileIdx].NameLength);
+}
+
+bool IncludeIndex::isFileUnchanged(uint32_t FileIdx) {
+  uint8_t &State = FileState[FileIdx];
+  if (!State) {
+    const FileRecord &Record = Files[FileIdx];
+    StringRef Name = getFileName(FileIdx);
+    uint64_t Size, Hash;
+    int64_t MTime;
+    bool Unchanged = statFile(Name, Size, MTime) && Size == Record.Size &&
+                     (MTime == Record.MTime ||
+                      (hashFile(Name, Hash) && Hash == Record.Hash));
+    State = Unchanged ? 1 : 2;
+  }
+  return State == 1;
+}
+
+bool IncludeIndex::isUpToDate(StringRef Tu, uint64_t CommandHash) {
+  auto It = TuIndex.find(Tu);
+  if (It == TuIndex.end())
+    return false;
+  const TuRecord &Record = Tus[It->second];
+  if (Record.CommandHash != CommandHash)
+    return false;
+  for (uint32_t I = 0; I < Record.NumDeps; ++I)
+    if (!isFileUnchanged(Deps[Record.FirstDep + I]))
+      return false;
+  return true;
+}
+
+std::vector<StringRef> IncludeIndex::getTus() const {
+  std::vector<StringRef> Result;
+  for (uint32_t T = 0; T < NumTus; ++T)
+    Result.push_back(getFileName(Tus[T].File));
+  return Result;
+}
+
+uint64_t IncludeIndex::getCommandHash(StringRef Tu) const {
+  auto It = TuIndex.find(Tu);
+  return It == TuIndex.end() ? 0 : uint64_t(Tus[It->second].CommandHash);
+}
+
+std::vector<StringRef> IncludeIndex::getFiles(StringRef Tu) const {
+  std::vector<StringRef> Result;
+  auto It = TuIndex.find(Tu);
+  if (It == TuIndex.end())
+    return Result;
+  const TuRecord &Record = Tus[It->second];
+  for (uint32_t I = 0; I < Record.NumDeps; ++I)
+    Result.push_back(getFileName(Deps[Record.FirstDep + I]));
+  return Result;
+}
+
+std::vector<std::string>
+IncludeIndex::findAffected(llvm::ArrayRef<std::string> Changed) const {
+  std::vector<bool> IsChanged(FileState.size());
+  for (const std::string &File : Changed) {
+    auto It = FileIndex.find(File);
+    if (It != FileIndex.end())
+      IsChanged[It->second] = true;
+  }
+  std::vector<std::string> Result;
+  for (uint32_t T = 0; T < NumTus; ++T) {
+    const TuRecord &Record = Tus[T];
+    for (uint32_t I = 0; I < Record.NumDeps; ++I) {
+      if (IsChanged[Deps[Record.FirstDep + I]]) {
+        Result.push_back(getFileName(Record.File).str());
+        break;
+      }
+    }
+  }
+  return Result;
+}
+
+bool IncludeIndex::getCurrentStamp(StringRef File, uint64_t Size,
+                                   int64_t MTime, Stamp &Result) const {
+  auto It = FileIndex.find(File);
+  if (It == FileIndex.end())
+    return false;
+  const FileRecord &Record = Files[It->second];
+  if (Record.Size != Size || Record.MTime != MTime)
+    return false;
+  Result = {Size, MTime, Record.Hash};
+  return true;
+}
+
+uint32_t IncludeIndexWriter::intern(StringRef File) {
+  auto [It, Inserted] = FileIds.try_emplace(File, FileNames.size());
+  if (Inserted)
+    FileNames.push_back(File.str());
+  return It->second;
+}
+
+void IncludeIndexWriter::addTu(StringRef Tu, uint64_t CommandHash,
+                               llvm::ArrayRef<StringRef> Files) {
+  Tus.push_back({intern(Tu), CommandHash, {}});
+  for (StringRef File : Files)
+    Tus.back().Deps.push_back(intern(File));
+}
+
+bool IncludeIndexWriter::write(StringRef Path,
+                               const IncludeIndex &Previous) const {
+  std::string Image;
+  llvm::raw_string_ostream OS(Image);
+  llvm::support::endian::Writer W(OS, llvm::support::little);
+
+  uint64_t NumDeps = 0, StringBytes = 0;
+  for (const Tu &T : Tus)
+    NumDeps += T.Deps.size();
+  for (const std::string &Name : FileNames)
+    StringBytes += Name.size();
+  if (NumDeps > UINT32_MAX || StringBytes > UINT32_MAX)
+    return false;
+
+  OS.write(Magic, sizeof(Magic));
+  W.write<uint32_t>(FileNames.size());
+  W.write<uint32_t>(Tus.size());
+  W.write<uint32_t>(NumDeps);
+  W.write<uint32_t>(0);
+  W.write<uint64_t>(StringBytes);
+
+  uint32_t NameOffset = 0;
+  for (const std::string &Name : FileNames) {
+    // A file that cannot be read is stored with a stamp that never matches.
+    IncludeIndex::Stamp Stamp{0, 0, 0};
+    if (statFile(Name, Stamp.Size, Stamp.MTime) &&
+        !Previous.getCurrentStamp(Name, Stamp.Size, Stamp.MTime, Stamp) &&
+        !hashFile(Name, Stamp.Hash))
+      Stamp.MTime = 0;
+    W.write<uint32_t>(NameOffset);
+    W.write<uint32_t>(Name.size());
+    W.write<uint64_t>(Stamp.Size);
+    W.write<int64_t>(Stamp.MTime);
+    W.write<uint64_t>(Stamp.Hash);
+    NameOffset += Name.size();
+  }
+  uint32_t FirstDep = 0;
+  for (const Tu &T : Tus) {
+    W.write<uint32_t>(T.File);
+    W.write<uint32_t>(FirstDep);
+    W.write<uint32_t>(T.Deps.size());
+    W.write<uint32_t>(0);
+    W.write<uint64_t>(T.CommandHash);
+    FirstDep += T.Deps.size();
+  }
+  for (const Tu &T : Tus)
+    for (uint32_t Dep : T.Deps)
+      W.write<uint32_t>(Dep);
+  for (const std::string &Name : FileNames)
+    OS << Name;
+  OS.flush();
+
+  int FD;
+  llvm::SmallString<256> TmpPath;
+  if (llvm::sys::fs::createUniqueFile(Path + ".tmp-%%%%%%%%", FD, TmpPath))
+    return false;
+  {
+    llvm::raw_fd_ostream Out(FD, /*shouldClose=*/true);
+    Out << Image;
+  }
+  if (llvm::sys::fs::rename(TmpPath, Path)) {
+    llvm::sys::fs::remove(TmpPath);
+    return false;
+  }
+  return true;
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
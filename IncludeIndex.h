@@ -0,0 +1,113 @@
+//===--- IncludeIndex.h - mir-migrate ---------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_INCLUDEINDEX_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_INCLUDEINDEX_H
+
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+/// Read-only view of a persisted include-dependency index: for every
+/// translation unit, the hash of its compile command and the files the
+/// preprocessor entered for it, each with the size, modification time and
+/// content hash it had when the TU was indexed.
+///
+/// The file is a little-endian binary image (header, file table, TU table,
+/// dependency array, string table) that is memory-mapped and used in place.
+class IncludeIndex {
+public:
+  /// Maps the index at \p Path. A missing, truncated or foreign file gives
+  /// an empty index.
+  static IncludeIndex load(StringRef Path);
+
+  static uint64_t
+  hashCommands(const std::vector<tooling::CompileCommand> &Commands);
+
+  /// True if \p Tu was indexed with \p CommandHash and none of its files has
+  /// changed on disk since. Files whose size and mtime differ are compared
+  /// by content, so a fresh checkout does not invalidate the index. Not
+  /// thread-safe: file checks are memoized.
+  bool isUpToDate(StringRef Tu, uint64_t CommandHash);
+
+  /// Every indexed TU.
+  std::vector<StringRef> getTus() const;
+  uint64_t getCommandHash(StringRef Tu) const;
+
+  /// Files recorded for \p Tu, main file first.
+  std::vector<StringRef> getFiles(StringRef Tu) const;
+
+  /// The indexed TUs among whose files any of \p Changed occurs.
+  std::vector<std::string> findAffected(llvm::ArrayRef<std::string> Changed) const;
+
+  struct Stamp {
+    uint64_t Size;
+    int64_t MTime;
+    uint64_t Hash;
+  };
+  /// The stamp recorded for \p File if it still has the same size and mtime.
+  bool getCurrentStamp(StringRef File, uint64_t Size, int64_t MTime,
+                       Stamp &Result) const;
+
+  struct Header;
+  struct FileRecord;
+  struct TuRecord;
+
+private:
+  StringRef getString(uint32_t Offset, uint32_t Length) const;
+  StringRef getFileName(uint32_t FileIdx) const;
+  bool isFileUnchanged(uint32_t FileIdx);
+
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  const FileRecord *Files = nullptr;
+  const TuRecord *Tus = nullptr;
+  const llvm::support::ulittle32_t *Deps = nullptr;
+  StringRef Strings;
+  llvm::StringMap<uint32_t> FileIndex;
+  llvm::StringMap<uint32_t> TuIndex;
+  uint32_t NumTus = 0;
+  /// Per file: 0 unknown, 1 unchanged, 2 changed.
+  std::vector<uint8_t> FileState;
+};
+
+/// Collects TU records and writes them as a new index.
+class IncludeIndexWriter {
+public:
+  void addTu(StringRef Tu, uint64_t CommandHash, llvm::ArrayRef<StringRef> Files);
+
+  /// Stamps every file, reusing the content hashes in \p Previous for files
+  /// whose size and mtime are unchanged, and atomically replaces \p Path.
+  bool write(StringRef Path, const IncludeIndex &Previous) const;
+
+private:
+  struct Tu {
+    uint32_t File;
+    uint64_t CommandHash;
+    std::vector<uint32_t> Deps;
+  };
+  uint32_t intern(StringRef File);
+
+  llvm::StringMap<uint32_t> FileIds;
+  std::vector<std::string> FileNames;
+  std::vector<Tu> Tus;
+};
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_INCLUDEINDEX_H
@@ -0,0 +1,221 @@
+//===--- LazyLogArgumentsCheck.cpp - clang-tidy ---------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "LazyLogArgumentsCheck.h"
+#include "CheckMetrics.h"
+
+#include "clang-tidy/utils/OptionsUtils.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "llvm/ADT/STLExtras.h"
+#include "utils.hpp"
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+namespace {
+
+/// How deep the body of a called function is followed to prove it cheap.
+constexpr unsigned MaxCalleeDepth = 2;
+
+constexpr StringRef LevelNames[] = {"DEBUG", "INFO", "WARN", "ERROR",
+                                    "FATAL"};
+
+/// The level a wrapper logs at, from its name: logDebug is DEBUG.
+StringRef getLevelFromName(StringRef Name) {
+  auto [Scope, Last] = Name.rsplit("::");
+  std::string Lower = (Last.empty() ? Scope : Last).lower();
+  for (StringRef Level : LevelNames)
+    if (StringRef(Lower).contains(Level.lower()))
+      return Level;
+  return {};
+}
+
+const Expr *strip(const Expr *E) {
+  while (true) {
+    const Expr *Next = E->IgnoreImplicit()->IgnoreParens();
+    if (Next == E)
+      return E;
+    E = Next;
+  }
+}
+
+bool isLiteral(const Expr &E) {
+  return llvm::isa<StringLiteral, IntegerLiteral, FloatingLiteral,
+                   CharacterLiteral, CXXBoolLiteralExpr, CXXNullPtrLiteralExpr>(
+      E);
+}
+
+const Expr *findExpensive(const Expr &Arg, unsigned Depth);
+
+/// Whether a call to \p Callee costs no more than its single, cheap return
+/// statement: getters, vector::operator[], size() and the like.
+bool isTrivialCallee(const FunctionDecl &Callee, unsigned Depth) {
+  if (Callee.getBuiltinID())
+    return true;
+  if (Depth >= MaxCalleeDepth)
+    return false;
+  const auto *Body = llvm::dyn_cast_or_null<CompoundStmt>(Callee.getBody());
+  if (!Body)
+    return false;
+  const ReturnStmt *Return = nullptr;
+  for (const Stmt *S : Body->body()) {
+    // Disabled assertions leave a null statement, as libstdc++'s
+    // __glibcxx_requires_subscript in vector::operator[] does, or a
+    // `(void)0`, as assert does under NDEBUG.
+    if (llvm::isa<NullStmt>(S))
+      continue;
+    if (const auto *E = llvm::dyn_cast<Expr>(S))
+      if (!E->HasSideEffects(Callee.getASTContext()))
+        continue;
+    if (Return)
+      return false;
+    Return = llvm::dyn_cast<ReturnStmt>(S);
+    if (!Return)
+      return false;
+  }
+  return Return && Return->getRetValue() &&
+         !findExpensive(*Return->getRetValue(), Depth + 1);
+}
+
+/// The first subexpression of \p Arg that costs more than a load, or null.
+/// Dependent code is assumed cheap, since its callees are not known.
+const Expr *findExpensive(const Expr &Arg, unsigned Depth) {
+  const Expr *E = strip(&Arg);
+  if (E->isInstantiationDependent() || isLiteral(*E) ||
+      llvm::isa<DeclRefExpr, CXXThisExpr, UnaryExprOrTypeTraitExpr, LambdaExpr,
+                UserDefinedLiteral>(E))
+    return nullptr;
+  if (const auto *Default = llvm::dyn_cast<CXXDefaultArgExpr>(E))
+    return findExpensive(*Default->getExpr(), Depth);
+  if (const auto *Construct = llvm::dyn_cast<CXXConstructExpr>(E)) {
+    // A std::string from a literal is fine; copying or converting a
+    // container is not.
+    if (!Construct->getConstructor()->isTrivial() &&
+        !llvm::all_of(Construct->arguments(), [](const Expr *A) {
+          return llvm::isa<CXXDefaultArgExpr>(A) || isLiteral(*strip(A));
+        }))
+      return E;
+  } else if (const auto *Call = llvm::dyn_cast<CallExpr>(E)) {
+    const FunctionDecl *Callee = Call->getDirectCallee();
+    if (!Callee || !isTrivialCallee(*Callee, Depth))
+      return E;
+  }
+  for (const Stmt *Child : E->children())
+    if (const auto *ChildExpr = llvm::dyn_cast_or_null<Expr>(Child))
+      if (const Expr *Found = findExpensive(*ChildExpr, Depth))
+        return Found;
+  return nullptr;
+}
+
+} // namespace
+
+LazyLogArgumentsCheck::LazyLogArgumentsCheck(StringRef Name,
+                                             ClangTidyContext *Context)
+    : ClangTidyCheck(Name, Context),
+      RawEagerLoggers(Options.get("EagerLoggers", "")),
+      RawLevels(Options.get("Levels", "DEBUG;INFO")),
+      GuardMacro(Options.get("GuardMacro", "")) {
+  std::vector<std::string> Levels;
+  for (StringRef Level : utils::options::parseStringList(RawLevels))
+    Levels.push_back(Level.trim().upper());
+  for (StringRef Entry : utils::options::parseStringList(RawEagerLoggers)) {
+    auto [Name, Level] = Entry.split('=');
+    Name = Name.trim();
+    std::string Upper = Level.trim().upper();
+    if (Upper.empty())
+      Upper = getLevelFromName(Name).str();
+    if (Name.empty() || !llvm::is_contained(LevelNames, Upper))
+      continue;
+    if (llvm::is_contained(Levels, Upper))
+      Loggers.push_back({Name.str(), Upper});
+  }
+}
+
+void LazyLogArgumentsCheck::storeOptions(ClangTidyOptions::OptionMap &Opts) {
+  Options.store(Opts, "EagerLoggers", RawEagerLoggers);
+  Options.store(Opts, "Levels", RawLevels);
+  Options.store(Opts, "GuardMacro", GuardMacro);
+}
+
+void LazyLogArgumentsCheck::registerMatchers(MatchFinder *Finder) {
+  if (Loggers.empty())
+    return;
+  std::vector<StringRef> Names;
+  for (const Logger &L : Loggers)
+    Names.push_back(L.Name);
+  Finder->addMatcher(
+      callExpr(isExpansionInMainFile(), unless(isInTemplateInstantiation()),
+               callee(functionDecl(hasAnyName(Names)).bind("logger")))
+          .bind("call"),
+      this);
+}
+
+const LazyLogArgumentsCheck::Logger *
+LazyLogArgumentsCheck::findLogger(const FunctionDecl &Callee) const {
+  std::string Qualified = "::" + Callee.getQualifiedNameAsString();
+  for (const Logger &L : Loggers) {
+    // As for hasName: a leading :: anchors the name, otherwise it is matched
+    // as a suffix of the qualified name.
+    bool Anchored = StringRef(L.Name).startswith("::");
+    std::string Wanted = Anchored ? L.Name : "::" + L.Name;
+    if (Anchored ? Qualified == Wanted : StringRef(Qualified).endswith(Wanted))
+      return &L;
+  }
+  return nullptr;
+}
+
+void LazyLogArgumentsCheck::check(const MatchFinder::MatchResult &Result) {
+  const auto *Call = Result.Nodes.getNodeAs<CallExpr>("call");
+  const auto *Callee = Result.Nodes.getNodeAs<FunctionDecl>("logger");
+  const Logger *L = findLogger(*Callee);
+  if (!L)
+    return;
+  const Expr *Expensive = nullptr;
+  for (const Expr *Arg : Call->arguments())
+    if ((Expensive = findExpensive(*Arg, 0)))
+      break;
+  if (!Expensive)
+    return;
+
+  std::string What;
+  llvm::raw_string_ostream OS(What);
+  const PrintingPolicy &Policy = Result.Context->getPrintingPolicy();
+  if (const auto *Construct = llvm::dyn_cast<CXXConstructExpr>(Expensive))
+    OS << "construction of '" << Construct->getType().getAsString(Policy)
+       << "'";
+  else if (const FunctionDecl *F =
+               llvm::cast<CallExpr>(Expensive)->getDirectCallee())
+    OS << "call to '" << F->getQualifiedNameAsString() << "'";
+  else
+    OS << "call";
+  OS.flush();
+  auto Diag = diag(Expensive->getBeginLoc(),
+                   "%0 is evaluated even when %1 logging is disabled")
+              << What << L->Level;
+
+  // Without a guard macro of our own, the call would have to be wrapped in
+  // rosconsole's location macros, which are internal to rosconsole.
+  if (GuardMacro.empty() || Call->getBeginLoc().isMacroID() ||
+      !isStatementInBlock(*Call, *Result.Context)) {
+    mir::noteSuppressedFix();
+    return;
+  }
+  Diag << FixItHint::CreateInsertion(
+      Call->getBeginLoc(),
+      (llvm::Twine("if (") + GuardMacro + "(" + L->Level + ")) ").str());
+  mir::noteFixIts(1);
+}
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,63 @@
+//===--- LazyLogArgumentsCheck.h - clang-tidy -------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_LAZYLOGARGUMENTSCHECK_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_LAZYLOGARGUMENTSCHECK_H
+
+#include "clang-tidy/ClangTidyCheck.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+/// Finds arguments of our own logging wrappers that cost more than a load to
+/// evaluate. Unlike the ROS_* macros, which only evaluate their arguments
+/// when the level is enabled, a function evaluates them on every call:
+///
+///   logDebug("cloud: " + toString(cloud));
+///
+/// An argument is cheap when it is built from literals, variables, member
+/// accesses and builtin operators, or calls to functions whose body is a
+/// single cheap return (getters, vector::operator[]). Other calls and
+/// non-trivial constructions, such as a container conversion, are expensive.
+///
+/// The wrappers are listed in the `EagerLoggers` option as `name` or
+/// `name=LEVEL`; without a level it is taken from the name (logDebug is
+/// DEBUG). Calls at a level in `Levels` (default DEBUG;INFO) are reported.
+/// When `GuardMacro` names a level check of our own, a call that is a
+/// statement of its own is guarded as `if (GUARD(DEBUG)) call;`. Otherwise
+/// calls are only reported.
+class LazyLogArgumentsCheck : public ClangTidyCheck {
+public:
+  LazyLogArgumentsCheck(StringRef Name, ClangTidyContext *Context);
+  void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+
+private:
+  struct Logger {
+    std::string Name;
+    /// DEBUG, INFO, WARN, ERROR or FATAL.
+    std::string Level;
+  };
+
+  const Logger *findLogger(const FunctionDecl &Callee) const;
+
+  const std::string RawEagerLoggers;
+  const std::string RawLevels;
+  const std::string GuardMacro;
+  std::vector<Logger> Loggers;
+};
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_LAZYLOGARGUMENTSCHECK_H
@@ -0,0 +1,249 @@
+//===--- MessageCopyCheck.cpp - clang-tidy --------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "MessageCopyCheck.h"
+#include "CheckMetrics.h"
+#include "RosMessageTypes.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/Analysis/Analyses/ExprMutationAnalyzer.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/STLExtras.h"
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+namespace {
+
+/// `nh.subscribe(topic, size, callback, ...)`. With the message type spelled
+/// out, `nh.subscribe<M>(...)`, only the by-value overload would match.
+bool isSubscribe(const CXXMemberCallExpr &Call) {
+  const auto *Callee =
+      llvm::dyn_cast<MemberExpr>(Call.getCallee()->IgnoreParens());
+  if (!Callee || Callee->hasExplicitTemplateArgs())
+    return false;
+  const CXXMethodDecl *Method = Call.getMethodDecl();
+  return Method && Method->getIdentifier() &&
+         Method->getName() == "subscribe" &&
+         Method->getParent()->getQualifiedNameAsString() == "ros::NodeHandle";
+}
+
+/// Whether \p Ref names its function to call it or to hand it to
+/// NodeHandle::subscribe; both keep working when a parameter becomes a
+/// const reference.
+bool isCallOrSubscription(const DeclRefExpr &Ref, ASTContext &Ctx) {
+  const Expr *E = &Ref;
+  while (true) {
+    auto Parents = Ctx.getParents(*E);
+    if (Parents.size() != 1)
+      return false;
+    const auto *Parent = Parents[0].get<Expr>();
+    if (!Parent)
+      return false;
+    if (const auto *Call = llvm::dyn_cast<CallExpr>(Parent)) {
+      if (Call->getCallee() == E)
+        return true;
+      const auto *Member = llvm::dyn_cast<CXXMemberCallExpr>(Call);
+      return Member && isSubscribe(*Member);
+    }
+    const auto *AddrOf = llvm::dyn_cast<UnaryOperator>(Parent);
+    if (!llvm::isa<ImplicitCastExpr, ParenExpr>(Parent) &&
+        !(AddrOf && AddrOf->getOpcode() == UO_AddrOf))
+      return false;
+    E = Parent;
+  }
+}
+
+bool isMutatedIn(const FunctionDecl &Function, const ParmVarDecl &Param,
+                 ASTContext &Ctx) {
+  if (ExprMutationAnalyzer(*Function.getBody(), Ctx).isMutated(&Param))
+    return true;
+  // Constructor initializers are not part of the body.
+  if (const auto *Ctor = llvm::dyn_cast<CXXConstructorDecl>(&Function))
+    for (const CXXCtorInitializer *Init : Ctor->inits())
+      if (Init->isWritten() &&
+          ExprMutationAnalyzer(*Init->getInit(), Ctx).isMutated(&Param))
+        return true;
+  return false;
+}
+
+/// Collects the fixes turning the declaration of \p Var, of type T, into
+/// one of `const T &`. Fails if the type is spelled through a macro.
+bool getConstReferenceFixes(const DeclaratorDecl &Var, const ASTContext &Ctx,
+                            llvm::SmallVectorImpl<FixItHint> &Fixes) {
+  const TypeSourceInfo *Info = Var.getTypeSourceInfo();
+  if (!Info)
+    return false;
+  TypeLoc Loc = Info->getTypeLoc();
+  SourceLocation Begin = Loc.getBeginLoc();
+  SourceLocation End = Lexer::getLocForEndOfToken(
+      Loc.getEndLoc(), 0, Ctx.getSourceManager(), Ctx.getLangOpts());
+  if (Begin.isInvalid() || End.isInvalid() || Begin.isMacroID() ||
+      End.isMacroID())
+    return false;
+  if (!Var.getType().isConstQualified())
+    Fixes.push_back(FixItHint::CreateInsertion(Begin, "const "));
+  Fixes.push_back(FixItHint::CreateInsertion(End, "&"));
+  return true;
+}
+
+} // namespace
+
+void MessageCopyCheck::registerMatchers(MatchFinder *Finder) {
+  auto ByValueRecord = parmVarDecl(
+      hasType(hasUnqualifiedDesugaredType(recordType())));
+  Finder->addMatcher(functionDecl(isDefinition(), isExpansionInMainFile(),
+                                  unless(isImplicit()), unless(isExternC()),
+                                  unless(isInstantiated()),
+                                  hasAnyParameter(ByValueRecord))
+                         .bind("function"),
+                     this);
+  Finder->addMatcher(
+      declRefExpr(to(functionDecl(hasAnyParameter(ByValueRecord))))
+          .bind("ref"),
+      this);
+
+  // Iterators are left out: their element can go away while they don't
+  // change.
+  auto SharedPtr = qualType(hasUnqualifiedDesugaredType(recordType(
+      hasDeclaration(cxxRecordDecl(hasAnyName("::boost::shared_ptr",
+                                              "::std::shared_ptr"))))));
+  auto Deref = cxxOperatorCallExpr(
+      hasOverloadedOperatorName("*"),
+      hasArgument(0, ignoringParenImpCasts(declRefExpr(to(
+                         varDecl(hasLocalStorage(),
+                                 hasType(qualType(anyOf(
+                                     SharedPtr, references(SharedPtr)))))
+                             .bind("ptr"))))));
+  Finder->addMatcher(
+      varDecl(hasLocalStorage(), isExpansionInMainFile(),
+              unless(isInTemplateInstantiation()),
+              hasInitializer(ignoringImplicit(cxxConstructExpr(
+                  argumentCountIs(1),
+                  hasArgument(0, ignoringParenImpCasts(Deref))))),
+              hasParent(declStmt(hasSingleDecl(anything()),
+                                 hasParent(compoundStmt().bind("scope")))))
+          .bind("copy"),
+      this);
+}
+
+void MessageCopyCheck::check(const MatchFinder::MatchResult &Result) {
+  Context = Result.Context;
+  if (const auto *Ref = Result.Nodes.getNodeAs<DeclRefExpr>("ref")) {
+    const auto *Function = llvm::cast<FunctionDecl>(Ref->getDecl());
+    if (!isCallOrSubscription(*Ref, *Result.Context))
+      Escaping.insert(Function->getCanonicalDecl());
+    return;
+  }
+  if (const auto *Function =
+          Result.Nodes.getNodeAs<FunctionDecl>("function")) {
+    checkFunction(*Function, *Result.Context);
+    return;
+  }
+  checkDereferenceCopy(*Result.Nodes.getNodeAs<VarDecl>("copy"),
+                       *Result.Nodes.getNodeAs<VarDecl>("ptr"),
+                       *Result.Nodes.getNodeAs<CompoundStmt>("scope"),
+                       *Result.Context);
+}
+
+void MessageCopyCheck::checkFunction(const FunctionDecl &Function,
+                                     ASTContext &Ctx) {
+  if (!Function.doesThisDeclarationHaveABody() ||
+      Function.isDependentContext() || Function.isMain() ||
+      Function.getTemplatedKind() != FunctionDecl::TK_NonTemplate)
+    return;
+  // The signature of an override is fixed by the base class; a lambda may
+  // also be converted to a function pointer of its exact signature.
+  if (const auto *Method = llvm::dyn_cast<CXXMethodDecl>(&Function))
+    if (Method->isVirtual() || Method->getParent()->isLambda())
+      return;
+  for (const ParmVarDecl *Param : Function.parameters()) {
+    if (Param->getType()->isReferenceType() ||
+        !getRosMessage(Param->getType()) || isMutatedIn(Function, *Param, Ctx))
+      continue;
+    ParamCopies.push_back({&Function, Param->getFunctionScopeIndex()});
+  }
+}
+
+void MessageCopyCheck::checkDereferenceCopy(const VarDecl &Copy,
+                                            const VarDecl &Ptr,
+                                            const Stmt &Scope,
+                                            ASTContext &Ctx) {
+  const CXXRecordDecl *Message = getRosMessage(Copy.getType());
+  const auto *Construct =
+      llvm::cast<CXXConstructExpr>(Copy.getInit()->IgnoreImplicit());
+  // A ConstPtr's pointee cannot change under the reference through another
+  // owner.
+  const Expr *Source = Construct->getArg(0)->IgnoreParenImpCasts();
+  if (!Message || Copy.getType()->isReferenceType() ||
+      !Construct->getConstructor()->isCopyConstructor() ||
+      !Source->getType().isConstQualified())
+    return;
+  ExprMutationAnalyzer Analyzer(Scope, Ctx);
+  llvm::SmallVector<FixItHint, 2> Fixes;
+  if (Analyzer.isMutated(&Copy) || Analyzer.isMutated(&Ptr) ||
+      !getConstReferenceFixes(Copy, Ctx, Fixes))
+    return;
+
+  auto Diag = diag(Copy.getLocation(),
+                   "%0 copies the %1 %2 points to (%3 bytes plus %4 "
+                   "heap-allocated members); bind a const reference instead",
+                   DiagnosticIDs::Warning);
+  Diag << &Copy << Copy.getType() << &Ptr
+       << static_cast<unsigned>(
+              Ctx.getTypeSizeInChars(Copy.getType()).getQuantity())
+       << countHeapMembers(*Message, Ctx);
+  for (const FixItHint &Fix : Fixes)
+    Diag << Fix;
+  mir::noteFixIts(Fixes.size());
+}
+
+void MessageCopyCheck::onEndOfTranslationUnit() {
+  const SourceManager *Sm = Context ? &Context->getSourceManager() : nullptr;
+  for (const ParamCopy &Copy : ParamCopies) {
+    const FunctionDecl *Function = Copy.Function;
+    llvm::SmallVector<FixItHint, 4> Fixes;
+    if (Escaping.count(Function->getCanonicalDecl()) ||
+        llvm::any_of(Function->redecls(),
+                     [Sm](const FunctionDecl *Redecl) {
+                       return !Sm->isInMainFile(
+                           Sm->getExpansionLoc(Redecl->getLocation()));
+                     }) ||
+        !llvm::all_of(Function->redecls(), [&](const FunctionDecl *Redecl) {
+          return getConstReferenceFixes(*Redecl->getParamDecl(Copy.Index),
+                                        *Context, Fixes);
+        })) {
+      mir::noteSuppressedFix();
+      continue;
+    }
+    const ParmVarDecl *Param = Function->getParamDecl(Copy.Index);
+    const CXXRecordDecl *Message = getRosMessage(Param->getType());
+    auto Diag = diag(Param->getLocation(),
+                     "%0 copies %1 on every call (%2 bytes plus %3 "
+                     "heap-allocated members); pass it by const reference",
+                     DiagnosticIDs::Warning);
+    Diag << Param << Param->getType()
+         << static_cast<unsigned>(
+                Context->getTypeSizeInChars(Param->getType()).getQuantity())
+         << countHeapMembers(*Message, *Context);
+    for (const FixItHint &Fix : Fixes)
+      Diag << Fix;
+    mir::noteFixIts(Fixes.size());
+  }
+  ParamCopies.clear();
+  Escaping.clear();
+  Context = nullptr;
+}
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
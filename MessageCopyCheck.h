@@ -0,0 +1,60 @@
+//===--- MessageCopyCheck.h - clang-tidy ------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_MESSAGECOPYCHECK_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_MESSAGECOPYCHECK_H
+
+#include "clang-tidy/ClangTidyCheck.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+/// Finds deep copies of ROS messages:
+///
+///   void cb(sensor_msgs::PointCloud2 msg);      // -> const ... &msg
+///   auto copy = *msg; // msg is a ConstPtr      // -> const auto &copy
+///
+/// Parameters are only rewritten when the function never modifies them and
+/// is only called or handed to ros::NodeHandle::subscribe, which accepts
+/// both signatures, and when all of its declarations are in the main file.
+/// Copies out of a ConstPtr are only rewritten when neither the copy nor the
+/// pointer is modified in the copy's scope. Diagnostics carry the message's
+/// size and its count of heap-allocated members to rank the fixes by.
+class MessageCopyCheck : public ClangTidyCheck {
+public:
+  MessageCopyCheck(StringRef Name, ClangTidyContext *Context)
+      : ClangTidyCheck(Name, Context) {}
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void onEndOfTranslationUnit() override;
+
+private:
+  struct ParamCopy {
+    const FunctionDecl *Function;
+    unsigned Index;
+  };
+
+  void checkFunction(const FunctionDecl &Function, ASTContext &Ctx);
+  void checkDereferenceCopy(const VarDecl &Copy, const VarDecl &Ptr,
+                            const Stmt &Scope, ASTContext &Ctx);
+
+  /// Reported once the whole TU has been seen, since any reference to the
+  /// function other than a call or a subscription rules the fix out.
+  llvm::SmallVector<ParamCopy> ParamCopies;
+  llvm::DenseSet<const FunctionDecl *> Escaping;
+  ASTContext *Context = nullptr;
+};
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_MESSAGECOPYCHECK_H
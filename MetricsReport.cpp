@@ -0,0 +1,154 @@
+//===--- MetricsReport.cpp - mir-migrate ----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "MetricsReport.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/WithColor.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+namespace {
+
+struct TuRecord {
+  std::string File;
+  int64_t WallMicros;
+  int64_t PeakRssKb;
+};
+
+struct CheckTotals {
+  int64_t RegisterMicros = 0;
+  int64_t CallbackMicros = 0;
+  int64_t Callbacks = 0;
+  int64_t FixIts = 0;
+  int64_t Suppressed = 0;
+  int64_t SlowestMicros = -1;
+  std::string SlowestFile;
+};
+
+int64_t getInteger(const llvm::json::Object &Object, llvm::StringRef Key) {
+  return Object.getInteger(Key).value_or(0);
+}
+
+double toSeconds(int64_t Micros) { return 1e-6 * Micros; }
+
+} // namespace
+
+bool printMetricsReport(llvm::StringRef File, unsigned TopN,
+                        llvm::raw_ostream &OS) {
+  auto Buffer = llvm::MemoryBuffer::getFileOrSTDIN(File);
+  if (!Buffer) {
+    llvm::WithColor::error() << File << ": " << Buffer.getError().message()
+                             << "\n";
+    return false;
+  }
+
+  std::vector<TuRecord> Tus;
+  llvm::StringMap<CheckTotals> Checks;
+  unsigned NumInvalid = 0;
+  llvm::SmallVector<llvm::StringRef, 0> Lines;
+  (*Buffer)->getBuffer().split(Lines, '\n', -1, /*KeepEmpty=*/false);
+  for (llvm::StringRef Line : Lines) {
+    llvm::Expected<llvm::json::Value> Record = llvm::json::parse(Line);
+    if (!Record) {
+      llvm::consumeError(Record.takeError());
+      ++NumInvalid;
+      continue;
+    }
+    const llvm::json::Object *Object = Record->getAsObject();
+    llvm::Optional<llvm::StringRef> Name =
+        Object ? Object->getString("file") : llvm::None;
+    if (!Name) {
+      ++NumInvalid;
+      continue;
+    }
+    Tus.push_back({Name->str(), getInteger(*Object, "wall_us"),
+                   getInteger(*Object, "peak_rss_kb")});
+    const llvm::json::Object *PerCheck = Object->getObject("checks");
+    if (!PerCheck)
+      continue;
+    for (const auto &[Check, Value] : *PerCheck) {
+      const llvm::json::Object *Counters = Value.getAsObject();
+      if (!Counters)
+        continue;
+      CheckTotals &Totals = Checks[Check.str()];
+      int64_t Micros = getInteger(*Counters, "register_us") +
+                       getInteger(*Counters, "callback_us");
+      Totals.RegisterMicros += getInteger(*Counters, "register_us");
+      Totals.CallbackMicros += getInteger(*Counters, "callback_us");
+      Totals.Callbacks += getInteger(*Counters, "callbacks");
+      Totals.FixIts += getInteger(*Counters, "fixits");
+      Totals.Suppressed += getInteger(*Counters, "suppressed");
+      if (Micros > Totals.SlowestMicros) {
+        Totals.SlowestMicros = Micros;
+        Totals.SlowestFile = Tus.back().File;
+      }
+    }
+  }
+
+  int64_t TotalMicros = 0, PeakRssKb = 0;
+  for (const TuRecord &Tu : Tus) {
+    TotalMicros += Tu.WallMicros;
+    PeakRssKb = std::max(PeakRssKb, Tu.PeakRssKb);
+  }
+  OS << Tus.size() << " TUs, " << llvm::format("%.1f", toSeconds(TotalMicros))
+     << "s of analysis, peak RSS " << PeakRssKb / 1024 << " MiB";
+  if (NumInvalid)
+    OS << ", " << NumInvalid << " unreadable records skipped";
+  OS << "\n";
+
+  size_t NumShown = std::min<size_t>(TopN, Tus.size());
+  std::partial_sort(Tus.begin(), Tus.begin() + NumShown, Tus.end(),
+                    [](const TuRecord &A, const TuRecord &B) {
+                      return A.WallMicros > B.WallMicros;
+                    });
+  OS << "\nSlowest " << NumShown << " TUs:\n";
+  for (const TuRecord &Tu : llvm::makeArrayRef(Tus).take_front(NumShown))
+    OS << llvm::format("%9.2fs %7lld MiB  ", toSeconds(Tu.WallMicros),
+                       static_cast<long long>(Tu.PeakRssKb / 1024))
+       << Tu.File << "\n";
+
+  std::vector<const llvm::StringMapEntry<CheckTotals> *> ByTime;
+  for (const auto &Entry : Checks)
+    ByTime.push_back(&Entry);
+  llvm::sort(ByTime, [](const auto *A, const auto *B) {
+    int64_t TimeA = A->getValue().RegisterMicros + A->getValue().CallbackMicros;
+    int64_t TimeB = B->getValue().RegisterMicros + B->getValue().CallbackMicros;
+    return TimeA != TimeB ? TimeA > TimeB : A->getKey() < B->getKey();
+  });
+  OS << "\nChecks by total time:\n"
+     << llvm::format("%-22s %10s %10s %10s %8s %10s  %s\n", "check", "time",
+                     "register", "callbacks", "fix-its", "suppressed",
+                     "slowest TU");
+  for (const auto *Entry : ByTime) {
+    const CheckTotals &Totals = Entry->getValue();
+    OS << llvm::format(
+              "%-22s %9.2fs %9.2fs %10lld %8lld %10lld  ",
+              Entry->getKey().str().c_str(),
+              toSeconds(Totals.RegisterMicros + Totals.CallbackMicros),
+              toSeconds(Totals.RegisterMicros),
+              static_cast<long long>(Totals.Callbacks),
+              static_cast<long long>(Totals.FixIts),
+              static_cast<long long>(Totals.Suppressed))
+       << Totals.SlowestFile << "\n";
+  }
+  return true;
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,31 @@
+//===--- MetricsReport.h - mir-migrate --------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_METRICSREPORT_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_METRICSREPORT_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+/// Aggregates the per-TU records InstrumentedCheck appended to \p File over
+/// one or more runs and prints the \p TopN slowest TUs, then every check by
+/// total time with its callbacks, fix-its, suppressed fixes and the TU it
+/// was slowest on. Lines that are not valid records are counted and skipped.
+/// Returns false if \p File cannot be read.
+bool printMetricsReport(llvm::StringRef File, unsigned TopN,
+                        llvm::raw_ostream &OS);
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_METRICSREPORT_H
@@ -0,0 +1,108 @@
+//===--- MigrateClient.cpp - mir-client -----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Thin client of mir-migrate -serve: sends its working directory and
+/// arguments over the server's Unix domain socket, copies the reply to stdout
+/// and exits with the server's exit code. It links nothing from LLVM, so it
+/// starts as fast as the shell does.
+///
+//===----------------------------------------------------------------------===//
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+bool writeAll(int FD, const std::string &Data) {
+  size_t Done = 0;
+  while (Done < Data.size()) {
+    ssize_t Written = ::write(FD, Data.data() + Done, Data.size() - Done);
+    if (Written < 0 && errno == EINTR)
+      continue;
+    if (Written <= 0)
+      return false;
+    Done += Written;
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: mir-client <socket> [mir-migrate args...]\n");
+    return 2;
+  }
+  sockaddr_un Address = {};
+  Address.sun_family = AF_UNIX;
+  if (std::strlen(argv[1]) >= sizeof(Address.sun_path)) {
+    std::fprintf(stderr, "mir-client: socket path too long\n");
+    return 2;
+  }
+  std::strcpy(Address.sun_path, argv[1]);
+  int FD = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (FD < 0 ||
+      ::connect(FD, reinterpret_cast<sockaddr *>(&Address), sizeof(Address))) {
+    std::fprintf(stderr, "mir-client: %s: %s\n", argv[1],
+                 std::strerror(errno));
+    return 2;
+  }
+
+  char Cwd[4096];
+  if (!::getcwd(Cwd, sizeof(Cwd))) {
+    std::fprintf(stderr, "mir-client: %s\n", std::strerror(errno));
+    return 2;
+  }
+  std::string Request(Cwd);
+  Request += '\0';
+  for (int I = 2; I < argc; ++I) {
+    Request += argv[I];
+    Request += '\0';
+  }
+  Request += '\0';
+  if (!writeAll(FD, Request)) {
+    std::fprintf(stderr, "mir-client: %s\n", std::strerror(errno));
+    return 2;
+  }
+
+  // Output is forwarded as it arrives; the exit code follows a NUL byte.
+  std::string ExitCode;
+  bool InExitCode = false;
+  char Buffer[65536];
+  while (true) {
+    ssize_t Read = ::read(FD, Buffer, sizeof(Buffer));
+    if (Read < 0 && errno == EINTR)
+      continue;
+    if (Read <= 0)
+      break;
+    size_t Output = Read;
+    if (!InExitCode) {
+      if (const void *Nul = std::memchr(Buffer, '\0', Read)) {
+        Output = static_cast<const char *>(Nul) - Buffer;
+        InExitCode = true;
+        ExitCode.assign(Buffer + Output + 1, Read - Output - 1);
+      }
+      std::fwrite(Buffer, 1, Output, stdout);
+    } else {
+      ExitCode.append(Buffer, Read);
+    }
+  }
+  std::fflush(stdout);
+  if (!InExitCode) {
+    std::fprintf(stderr, "mir-client: server closed the connection\n");
+    return 2;
+  }
+  return std::atoi(ExitCode.c_str());
+}
@@ -0,0 +1,945 @@
+//===--- MigrateDriver.cpp - mir-migrate ----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Batch driver for the mir-* checks. Instead of one clang-tidy process (and
+/// one plugin load) per file, it reads compile_commands.json once and runs
+/// every translation unit on a work-stealing thread pool inside a single
+/// process. Each worker owns its ClangTidyContext; diagnostics are merged in
+/// compilation database order so the output does not depend on scheduling.
+///
+//===----------------------------------------------------------------------===//
+
+#include "FileContentCache.h"
+#include "FixMerger.h"
+#include "HeaderGuardScanner.h"
+#include "IncludeIndex.h"
+#include "MetricsReport.h"
+#include "PreambleCache.h"
+#include "ResultCache.h"
+#include "ServerSocket.h"
+#include "SourcePrefilter.h"
+#include "TuFingerprint.h"
+#include "TuScheduler.h"
+#include "TuTimings.h"
+
+#include "clang-tidy/ClangTidy.h"
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang-tidy/ClangTidyOptions.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/JSONCompilationDatabase.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/WithColor.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+using namespace clang;
+using namespace clang::tidy;
+using namespace llvm;
+
+// Force the mir-* module in main.cpp to be linked in, the same way clang-tidy
+// anchors its built-in modules.
+extern volatile int CTTestModuleAnchorSource;
+static int LLVM_ATTRIBUTE_UNUSED CTTestModuleAnchorDestination =
+    CTTestModuleAnchorSource;
+
+static cl::OptionCategory MigrateCategory("mir-migrate options");
+
+static cl::opt<std::string>
+    BuildPath("p", cl::desc("Directory containing compile_commands.json"),
+              cl::init("."), cl::cat(MigrateCategory));
+
+static cl::list<std::string>
+    SourceFilters(cl::Positional,
+                  cl::desc("[<source> ...] (default: every file in the "
+                           "compilation database)"),
+                  cl::cat(MigrateCategory));
+
+static cl::opt<std::string>
+    Checks("checks",
+           cl::desc("Comma-separated list of globs, as for clang-tidy. "
+                    "Overrides the .clang-tidy configuration."),
+           cl::init(""), cl::cat(MigrateCategory));
+
+static cl::opt<bool> Fix("fix", cl::desc("Apply suggested fixes"),
+                         cl::init(false), cl::cat(MigrateCategory));
+
+static cl::opt<std::string>
+    ExportFixes("export-fixes",
+                cl::desc("YAML file to store suggested fixes in, in the "
+                         "format of clang-apply-replacements"),
+                cl::value_desc("filename"), cl::cat(MigrateCategory));
+
+static cl::opt<unsigned>
+    Jobs("j", cl::desc("Number of worker threads (default: all cores)"),
+         cl::init(0), cl::cat(MigrateCategory));
+
+static cl::opt<std::string>
+    CacheDir("cache-dir",
+             cl::desc("Directory of the persistent per-TU result cache. TUs "
+                      "whose preprocessed input, flags, check options and "
+                      "driver build are unchanged are replayed from it."),
+             cl::value_desc("directory"), cl::cat(MigrateCategory));
+
+static cl::opt<bool> SharePreambles(
+    "share-preambles",
+    cl::desc("Build one precompiled header per group of TUs that start with "
+             "the same #include <...> lines and share compile flags, and "
+             "parse every member on top of it"),
+    cl::init(false), cl::cat(MigrateCategory));
+
+static cl::opt<unsigned>
+    PreambleMinGroup("preamble-min-group",
+                     cl::desc("Smallest group that gets a shared preamble"),
+                     cl::init(2), cl::cat(MigrateCategory));
+
+static cl::opt<bool> Prefilter(
+    "prefilter",
+    cl::desc("Skip TUs without parsing them when every enabled check only "
+             "fires on tokens (e.g. ROS_*_STREAM for mir-rosstreamfmt) that a "
+             "byte scan of the main file does not find. Compiler errors in "
+             "skipped TUs are not reported."),
+    cl::init(false), cl::cat(MigrateCategory));
+
+static cl::opt<bool> PrefilterIncludes(
+    "prefilter-includes",
+    cl::desc("Also scan headers reached through #include \"...\" before "
+             "skipping a TU"),
+    cl::init(false), cl::cat(MigrateCategory));
+
+static cl::opt<std::string> ChangedFiles(
+    "changed-files",
+    cl::desc("File listing changed paths, one per line (- for stdin), e.g. "
+             "from git diff --name-only. Only TUs whose main file or "
+             "transitive includes contain one of them are analyzed. Relative "
+             "paths are taken from the directory bazel run was started in, "
+             "else from -p."),
+    cl::value_desc("filename"), cl::cat(MigrateCategory));
+
+static cl::opt<std::string> IncludeIndexPath(
+    "include-index",
+    cl::desc("Include-dependency index used with -changed-files (default: "
+             "<p>/mir-include-index). Only TUs whose files or command "
+             "changed since the last run are re-preprocessed to update it."),
+    cl::value_desc("filename"), cl::cat(MigrateCategory));
+
+static cl::opt<bool> HeaderGuards(
+    "header-guards",
+    cl::desc("Only run mir-headercheck, on every header below the positional "
+             "directories (default: -p), by lexing each header once instead "
+             "of parsing the translation units that include it"),
+    cl::init(false), cl::cat(MigrateCategory));
+
+static cl::opt<bool> ApplyFixes(
+    "apply-fixes",
+    cl::desc("Only merge and apply the fixes in the clang-tidy "
+             "-export-fixes YAML files below the positional paths, like "
+             "clang-apply-replacements. Files are read one at a time and "
+             "identical replacements are kept once."),
+    cl::init(false), cl::cat(MigrateCategory));
+
+static cl::opt<std::string> Metrics(
+    "metrics",
+    cl::desc("Append a JSON line per analyzed TU with each check's time, "
+             "callbacks, fix-its and suppressed fixes to this file. Sets the "
+             "MetricsFile check option; TUs replayed from the cache or "
+             "skipped by the prefilter are not recorded."),
+    cl::value_desc("filename"), cl::cat(MigrateCategory));
+
+static cl::opt<std::string> MetricsReport(
+    "metrics-report",
+    cl::desc("Only summarize a -metrics file: the slowest TUs and every "
+             "check's totals"),
+    cl::value_desc("filename"), cl::cat(MigrateCategory));
+
+static cl::opt<unsigned>
+    MetricsTop("metrics-top",
+               cl::desc("Number of TUs listed by -metrics-report"),
+               cl::init(20), cl::cat(MigrateCategory));
+
+static cl::opt<std::string> Serve(
+    "serve",
+    cl::desc("Stay resident and analyze the requests mir-client sends to this "
+             "Unix domain socket. The compilation database, file contents "
+             "and, with -share-preambles, the preambles stay loaded between "
+             "requests and are only refreshed when their files change."),
+    cl::value_desc("socket"), cl::cat(MigrateCategory));
+
+static cl::opt<std::string> FileList(
+    "file-list",
+    cl::desc("File listing the sources to analyze, one per line, e.g. a "
+             "shard list written by -shards"),
+    cl::value_desc("filename"), cl::cat(MigrateCategory));
+
+static cl::opt<std::string> Timings(
+    "timings",
+    cl::desc("Per-TU analysis times of earlier runs. They order the TUs on "
+             "the thread pool and balance -shards, and the times this run "
+             "measures are folded back in."),
+    cl::value_desc("filename"), cl::cat(MigrateCategory));
+
+static cl::opt<unsigned> Shards(
+    "shards",
+    cl::desc("Only split the TUs into this many lists of about equal "
+             "predicted analysis time, for -file-list on separate machines. "
+             "TUs without a -timings entry are estimated from their include "
+             "count in the include index, or else their size."),
+    cl::init(0), cl::cat(MigrateCategory));
+
+static cl::opt<std::string>
+    ShardDir("shard-dir",
+             cl::desc("Directory -shards writes shard-<n>.txt to"),
+             cl::init("."), cl::value_desc("directory"),
+             cl::cat(MigrateCategory));
+
+static std::unique_ptr<ClangTidyOptionsProvider> createOptionsProvider() {
+  ClangTidyGlobalOptions GlobalOptions;
+  ClangTidyOptions DefaultOptions = ClangTidyOptions::getDefaults();
+  DefaultOptions.Checks = "-*,mir-*";
+  ClangTidyOptions OverrideOptions;
+  if (!Checks.empty())
+    OverrideOptions.Checks = Checks;
+  if (!Metrics.empty()) {
+    SmallString<256> Path(Metrics);
+    sys::fs::make_absolute(Path);
+    OverrideOptions.CheckOptions["MetricsFile"] =
+        ClangTidyOptions::ClangTidyValue(Path.str());
+  }
+  return std::make_unique<FileOptionsProvider>(
+      std::move(GlobalOptions), std::move(DefaultOptions),
+      std::move(OverrideOptions), vfs::getRealFileSystem());
+}
+
+/// State owned by one worker thread. ClangTidyContext is not thread-safe, and
+/// the file system gets its own working directory so that ClangTool changing
+/// into a compile command's directory does not chdir the whole process. With
+/// \p Contents, file reads go through that shared cache.
+struct WorkerState {
+  explicit WorkerState(mir::FileContentCache *Contents = nullptr)
+      : Context(createOptionsProvider()),
+        FS(new vfs::OverlayFileSystem(
+            Contents
+                ? Contents->createFileSystem(vfs::createPhysicalFileSystem())
+                : vfs::createPhysicalFileSystem())) {}
+
+  ClangTidyContext Context;
+  IntrusiveRefCntPtr<vfs::OverlayFileSystem> FS;
+};
+
+static uint64_t estimateCost(StringRef File) {
+  uint64_t Size = 0;
+  if (sys::fs::file_size(File, Size))
+    return 0;
+  return Size;
+}
+
+/// Makes \p Path absolute against \p Directory and removes dots.
+static std::string normalizePath(StringRef Directory, StringRef Path) {
+  SmallString<256> Result(Path);
+  sys::fs::make_absolute(Directory, Result);
+  sys::path::remove_dots(Result, /*remove_dot_dot=*/true);
+  return Result.str().str();
+}
+
+/// Reads the non-empty lines of \p Path (- for stdin) into \p Lines.
+static bool readLines(StringRef Path, std::vector<std::string> &Lines) {
+  auto List = MemoryBuffer::getFileOrSTDIN(Path);
+  if (!List) {
+    WithColor::error() << Path << ": " << List.getError().message() << "\n";
+    return false;
+  }
+  SmallVector<StringRef, 64> Split;
+  (*List)->getBuffer().split(Split, '\n', -1, /*KeepEmpty=*/false);
+  for (StringRef Line : Split) {
+    Line = Line.trim();
+    if (!Line.empty())
+      Lines.push_back(Line.str());
+  }
+  return true;
+}
+
+/// The directory relative -changed-files paths are resolved against. Under
+/// bazel run the working directory is the runfiles tree, not the checkout.
+static std::string getChangedFilesBase() {
+  SmallString<256> Base(BuildPath);
+  if (const char *Dir = std::getenv("BUILD_WORKING_DIRECTORY"))
+    Base = Dir;
+  sys::fs::make_absolute(Base);
+  return Base.str().str();
+}
+
+static std::string getIncludeIndexPath() {
+  if (!IncludeIndexPath.empty())
+    return IncludeIndexPath;
+  SmallString<256> Default(BuildPath);
+  sys::path::append(Default, "mir-include-index");
+  return Default.str().str();
+}
+
+/// Brings the include index at \p IndexPath up to date for \p Files,
+/// preprocessing only TUs whose record is missing or stale, and returns the
+/// members of \p Files whose main file or includes are in \p Changed. TUs
+/// that cannot be indexed are always returned.
+static std::vector<std::string>
+selectAffectedFiles(const tooling::CompilationDatabase &Compilations,
+                    const std::vector<std::string> &Files,
+                    StringRef IndexPath, ArrayRef<std::string> Changed,
+                    mir::TuScheduler &Scheduler,
+                    std::vector<std::unique_ptr<WorkerState>> &Workers) {
+  mir::IncludeIndex Previous = mir::IncludeIndex::load(IndexPath);
+  std::vector<uint64_t> CommandHashes(Files.size());
+  std::vector<bool> UpToDate(Files.size());
+  std::vector<mir::TuJob> StaleJobs;
+  for (size_t I = 0; I < Files.size(); ++I) {
+    CommandHashes[I] = mir::IncludeIndex::hashCommands(
+        Compilations.getCompileCommands(Files[I]));
+    UpToDate[I] = Previous.isUpToDate(Files[I], CommandHashes[I]);
+    if (!UpToDate[I])
+      StaleJobs.push_back({Files[I], estimateCost(Files[I]), I});
+  }
+  size_t NumStale = StaleJobs.size();
+
+  std::vector<std::vector<std::string>> Reindexed(Files.size());
+  std::vector<char> Indexed(Files.size());
+  Scheduler.run(std::move(StaleJobs),
+                [&](unsigned Worker, const mir::TuJob &Job) {
+                  mir::TuFingerprint Fingerprint;
+                  if (!mir::computeFingerprint(Compilations, Job.File,
+                                               Workers[Worker]->FS,
+                                               Fingerprint))
+                    return;
+                  std::string Directory =
+                      Compilations.getCompileCommands(Job.File)
+                          .front()
+                          .Directory;
+                  auto &Deps = Reindexed[Job.Index];
+                  for (const std::string &File : Fingerprint.Files)
+                    Deps.push_back(normalizePath(Directory, File));
+                  Indexed[Job.Index] = true;
+                });
+
+  // Records of TUs outside this run are carried over unchanged.
+  mir::IncludeIndexWriter Writer;
+  StringSet<> Selected;
+  for (const std::string &File : Files)
+    Selected.insert(File);
+  for (StringRef Tu : Previous.getTus())
+    if (!Selected.contains(Tu))
+      Writer.addTu(Tu, Previous.getCommandHash(Tu), Previous.getFiles(Tu));
+  std::vector<std::string> Unindexed;
+  for (size_t I = 0; I < Files.size(); ++I) {
+    if (UpToDate[I]) {
+      Writer.addTu(Files[I], CommandHashes[I], Previous.getFiles(Files[I]));
+    } else if (Indexed[I]) {
+      std::vector<StringRef> Deps(Reindexed[I].begin(), Reindexed[I].end());
+      Writer.addTu(Files[I], CommandHashes[I], Deps);
+    } else {
+      Unindexed.push_back(Files[I]);
+    }
+  }
+  if (!Writer.write(IndexPath, Previous))
+    WithColor::warning() << "cannot write include index " << IndexPath
+                         << "\n";
+  errs() << "mir-migrate: include index: re-indexed " << NumStale << " of "
+         << Files.size() << " TUs\n";
+
+  mir::IncludeIndex Index = mir::IncludeIndex::load(IndexPath);
+  StringSet<> Affected;
+  for (std::string &File : Index.findAffected(Changed))
+    Affected.insert(File);
+  for (std::string &File : Unindexed)
+    Affected.insert(File);
+  std::vector<std::string> Result;
+  for (const std::string &File : Files)
+    if (Affected.contains(File))
+      Result.push_back(File);
+  return Result;
+}
+
+/// Concatenates the per-TU results in \p Results order, dropping diagnostics
+/// that several TUs reported for the same header location.
+static std::vector<ClangTidyError>
+mergeResults(std::vector<std::vector<ClangTidyError>> &Results) {
+  std::vector<ClangTidyError> Merged;
+  StringSet<> Seen;
+  for (auto &TuErrors : Results) {
+    for (auto &Error : TuErrors) {
+      std::string Key;
+      raw_string_ostream(Key)
+          << Error.DiagnosticName << '\0' << Error.Message.FilePath << '\0'
+          << Error.Message.FileOffset << '\0' << Error.Message.Message;
+      if (!Seen.insert(Key).second)
+        continue;
+      Merged.push_back(std::move(Error));
+    }
+  }
+  return Merged;
+}
+
+/// Reports the conflicts among the fixes in \p Merger, rewrites the files
+/// with the remaining ones and returns whether every file could be written.
+static bool applyMergedFixes(mir::FixMerger &Merger) {
+  for (const auto &Conflict : Merger.resolve())
+    WithColor::warning() << Conflict.File << ":" << Conflict.Offset
+                         << ": conflicting fixes from " << Conflict.First
+                         << " and " << Conflict.Second
+                         << "; neither is applied\n";
+  unsigned NumApplied = 0;
+  unsigned NumFailed = Merger.apply(NumApplied, errs());
+  errs() << "mir-migrate: applied " << NumApplied << " of "
+         << Merger.getNumDistinct() << " distinct replacements ("
+         << Merger.getNumAdded() << " reported)\n";
+  return !NumFailed;
+}
+
+/// Prints the merged diagnostics of all TUs, applies or exports the fixes and
+/// returns the process exit code.
+static int reportResults(std::vector<std::vector<ClangTidyError>> &Results) {
+  std::vector<ClangTidyError> Errors = mergeResults(Results);
+
+  // Reporting and fix application happen on the main thread only.
+  ClangTidyContext Context(createOptionsProvider());
+  IntrusiveRefCntPtr<vfs::OverlayFileSystem> BaseFS(
+      new vfs::OverlayFileSystem(vfs::getRealFileSystem()));
+  unsigned WarningsAsErrorsCount = 0;
+  handleErrors(Errors, Context, FB_NoFix, WarningsAsErrorsCount, BaseFS);
+
+  if (Fix) {
+    mir::FixMerger Merger;
+    for (const ClangTidyError &Error : Errors)
+      Merger.addDiagnostic(Error);
+    if (!applyMergedFixes(Merger))
+      return 1;
+  }
+
+  if (!ExportFixes.empty() && !Errors.empty()) {
+    std::error_code EC;
+    raw_fd_ostream OS(ExportFixes, EC, sys::fs::OF_None);
+    if (EC) {
+      WithColor::error() << EC.message() << "\n";
+      return 1;
+    }
+    exportReplacements("", Errors, OS);
+  }
+
+  if (WarningsAsErrorsCount) {
+    errs() << WarningsAsErrorsCount << " warning"
+           << (WarningsAsErrorsCount == 1 ? "" : "s")
+           << " treated as error" << (WarningsAsErrorsCount == 1 ? "" : "s")
+           << "\n";
+    return 1;
+  }
+  return 0;
+}
+
+/// Lists every regular file below \p Roots, without following symlinks or
+/// descending into hidden directories.
+static std::vector<std::string> findFiles(ArrayRef<std::string> Roots) {
+  std::vector<std::string> Files;
+  for (const std::string &Root : Roots) {
+    SmallString<256> AbsRoot(Root);
+    sys::fs::make_absolute(AbsRoot);
+    sys::path::remove_dots(AbsRoot, /*remove_dot_dot=*/true);
+    if (sys::fs::is_regular_file(AbsRoot)) {
+      Files.push_back(AbsRoot.str().str());
+      continue;
+    }
+    std::error_code EC;
+    for (sys::fs::recursive_directory_iterator It(AbsRoot, EC,
+                                                  /*follow_symlinks=*/false),
+         End;
+         It != End && !EC; It.increment(EC)) {
+      StringRef Name = sys::path::filename(It->path());
+      if (It->type() == sys::fs::file_type::directory_file) {
+        if (Name.startswith("."))
+          It.no_push();
+        continue;
+      }
+      if (It->type() == sys::fs::file_type::regular_file)
+        Files.push_back(It->path());
+    }
+  }
+  return Files;
+}
+
+/// The -apply-fixes mode: merges exported fixes file by file, so memory grows
+/// with the distinct replacements rather than with the number of TUs.
+static int runApplyFixes() {
+  mir::FixMerger Merger;
+  unsigned NumUnreadable = 0;
+  for (const std::string &File : findFiles(SourceFilters))
+    if (sys::path::extension(File) == ".yaml" &&
+        !Merger.addExportedFixes(File, errs()))
+      ++NumUnreadable;
+  return applyMergedFixes(Merger) && !NumUnreadable ? 0 : 1;
+}
+
+/// The -header-guards mode: lexes each header once, in parallel, instead of
+/// checking it as a side effect of every TU that includes it.
+static int runHeaderGuards() {
+  std::vector<std::string> Roots(SourceFilters.begin(), SourceFilters.end());
+  if (Roots.empty())
+    Roots.push_back(BuildPath);
+  std::vector<std::string> Files = findFiles(Roots);
+  std::vector<mir::TuJob> HeaderJobs;
+  for (size_t I = 0; I < Files.size(); ++I)
+    HeaderJobs.push_back({Files[I], estimateCost(Files[I]), I});
+
+  unsigned NumWorkers =
+      Jobs ? Jobs.getValue() : hardware_concurrency().compute_thread_count();
+  mir::TuScheduler Scheduler(NumWorkers);
+  std::vector<std::unique_ptr<ClangTidyContext>> Contexts;
+  std::vector<std::unique_ptr<mir::HeaderGuardScanner>> Scanners;
+  for (unsigned I = 0; I < Scheduler.getNumWorkers(); ++I) {
+    Contexts.push_back(
+        std::make_unique<ClangTidyContext>(createOptionsProvider()));
+    Scanners.push_back(
+        std::make_unique<mir::HeaderGuardScanner>(*Contexts.back(), Roots[0]));
+  }
+
+  std::vector<std::vector<ClangTidyError>> Results(Files.size());
+  Scheduler.run(std::move(HeaderJobs),
+                [&](unsigned Worker, const mir::TuJob &Job) {
+                  Scanners[Worker]->scan(Job.File, Results[Job.Index]);
+                });
+  return reportResults(Results);
+}
+
+/// Whether anything enabled for \p File looks at headers outside the TU.
+static bool needsProjectHeaders(ClangTidyContext &Context, StringRef File) {
+  Context.setCurrentFile(File);
+  return Context.isCheckEnabled("mir-headercheck");
+}
+
+/// Groups \p Files into shared preambles of at least \p MinGroupSize TUs.
+static void planPreambles(mir::PreambleCache &Preambles,
+                          ArrayRef<std::string> Files, unsigned MinGroupSize) {
+  ClangTidyContext PlanContext(createOptionsProvider());
+  Preambles.plan(Files, MinGroupSize, [&](StringRef File) {
+    return needsProjectHeaders(PlanContext, File);
+  });
+}
+
+static std::unique_ptr<mir::ResultCache> createResultCache(const char *Argv0) {
+  if (CacheDir.empty())
+    return nullptr;
+  return std::make_unique<mir::ResultCache>(
+      CacheDir, mir::ResultCache::getExecutableBuildId(
+                    Argv0, reinterpret_cast<void *>(&createOptionsProvider)));
+}
+
+/// Analyzes \p Files on \p Workers, replaying TUs from \p Cache where it
+/// can, reports the results and returns the exit code. \p AnalysisDb is
+/// \p Compilations, or its view with the shared preambles of \p Preambles.
+static int analyzeFiles(const tooling::CompilationDatabase &Compilations,
+                        const tooling::CompilationDatabase &AnalysisDb,
+                        const std::vector<std::string> &Files,
+                        mir::TuScheduler &Scheduler,
+                        std::vector<std::unique_ptr<WorkerState>> &Workers,
+                        mir::ResultCache *Cache,
+                        mir::PreambleCache *Preambles,
+                        mir::TuTimings *TimingDb) {
+  std::unique_ptr<mir::TuCostModel> Costs;
+  if (TimingDb)
+    Costs = std::make_unique<mir::TuCostModel>(*TimingDb, nullptr);
+  std::vector<mir::TuJob> TuJobs;
+  for (size_t I = 0; I < Files.size(); ++I) {
+    uint64_t Cost = Costs ? Costs->estimate(Files[I]) : estimateCost(Files[I]);
+    TuJobs.push_back({Files[I], Cost, I});
+  }
+
+  std::unique_ptr<mir::SourcePrefilter> Filter;
+  if (Prefilter)
+    Filter = std::make_unique<mir::SourcePrefilter>(Compilations,
+                                                    PrefilterIncludes);
+  std::atomic<unsigned> NumSkipped{0}, NumAnalyzed{0};
+  std::atomic<uint64_t> AnalysisNanos{0};
+
+  std::vector<std::vector<ClangTidyError>> Results(Files.size());
+  std::vector<uint64_t> TuNanos(Files.size());
+  bool ApplyAnyFix = Fix || !ExportFixes.empty();
+  Scheduler.run(std::move(TuJobs), [&](unsigned Worker, const mir::TuJob &Job) {
+    WorkerState &State = *Workers[Worker];
+    std::vector<ClangTidyError> &TuErrors = Results[Job.Index];
+    if (Filter && Filter->canSkip(State.Context, Job.File)) {
+      ++NumSkipped;
+      return;
+    }
+    std::string Key;
+    mir::TuFingerprint Fingerprint;
+    if (Cache && mir::computeFingerprint(Compilations, Job.File, State.FS,
+                                         Fingerprint)) {
+      State.Context.setCurrentFile(Job.File);
+      Key = Cache->computeKey(Fingerprint.Digest,
+                              Compilations.getCompileCommands(Job.File),
+                              configurationAsText(State.Context.getOptions()),
+                              ApplyAnyFix);
+      if (Cache->lookup(Key, State.Context, TuErrors))
+        return;
+    }
+    auto Start = std::chrono::steady_clock::now();
+    TuErrors = runClangTidy(State.Context, AnalysisDb, {Job.File}, State.FS,
+                            ApplyAnyFix);
+    TuNanos[Job.Index] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - Start)
+                             .count();
+    AnalysisNanos += TuNanos[Job.Index];
+    ++NumAnalyzed;
+    if (!Key.empty())
+      Cache->store(Key, Job.File, TuErrors);
+  });
+  if (Filter) {
+    errs() << "mir-migrate: prefilter skipped " << NumSkipped << " of "
+           << Files.size() << " TUs";
+    // Assume skipped TUs would have cost as much as the analyzed ones.
+    if (NumAnalyzed)
+      errs() << format(", ~%.1fs of analysis saved",
+                       1e-9 * AnalysisNanos / NumAnalyzed * NumSkipped);
+    errs() << "\n";
+  }
+  if (Cache)
+    errs() << "mir-migrate: result cache: " << Cache->getHits() << " hits, "
+           << Cache->getMisses() << " misses\n";
+  if (Preambles)
+    errs() << "mir-migrate: " << Preambles->getNumGroups()
+           << " shared preamble groups\n";
+  // Only parsed TUs are timed; skipped and replayed ones say nothing about
+  // the cost of a parse on another machine.
+  if (TimingDb)
+    for (size_t I = 0; I < Files.size(); ++I)
+      if (TuNanos[I])
+        TimingDb->record(Files[I], TuNanos[I]);
+
+  return reportResults(Results);
+}
+
+/// The state -serve keeps between requests. Each request re-stats what it
+/// depends on: the compilation database is reloaded when it changes, edited
+/// files are re-read, and a shared preamble is rebuilt when one of its
+/// headers changed or is regrouped when a TU's leading includes did.
+class MigrateServer {
+public:
+  explicit MigrateServer(std::unique_ptr<mir::ResultCache> Cache)
+      : Scheduler(Jobs ? Jobs.getValue()
+                       : hardware_concurrency().compute_thread_count()),
+        Cache(std::move(Cache)), DefaultFix(Fix), DefaultChecks(Checks),
+        DefaultExportFixes(ExportFixes) {
+    SmallString<256> Path(BuildPath);
+    sys::fs::make_absolute(Path);
+    sys::path::append(Path, "compile_commands.json");
+    DatabasePath = Path.str().str();
+  }
+
+  ~MigrateServer() { resetPreambles(); }
+
+  /// Runs \p Request as mir-migrate would with its arguments and returns the
+  /// exit code. Only -fix, -checks=, -export-fixes= and sources are accepted;
+  /// everything else is fixed when the server starts.
+  int handle(const mir::ServerRequest &Request) {
+    Fix = DefaultFix;
+    Checks = DefaultChecks;
+    ExportFixes = DefaultExportFixes;
+    std::vector<std::string> Files;
+    for (StringRef Arg : Request.Args) {
+      if (Arg == "-fix" || Arg == "--fix") {
+        Fix = true;
+      } else if (Arg.consume_front("-checks=") ||
+                 Arg.consume_front("--checks=")) {
+        Checks = Arg.str();
+      } else if (Arg.consume_front("-export-fixes=") ||
+                 Arg.consume_front("--export-fixes=")) {
+        ExportFixes = normalizePath(Request.WorkingDirectory, Arg);
+      } else if (Arg.startswith("-")) {
+        WithColor::error() << "not supported in a -serve request: " << Arg
+                           << "\n";
+        return 1;
+      } else {
+        Files.push_back(normalizePath(Request.WorkingDirectory, Arg));
+      }
+    }
+    if (!refreshDatabase())
+      return 1;
+    if (Files.empty())
+      Files = Compilations->getAllFiles();
+    refreshContents();
+
+    // Contexts are cheap and pick up -checks and .clang-tidy edits.
+    std::vector<std::unique_ptr<WorkerState>> Workers;
+    for (unsigned I = 0; I < Scheduler.getNumWorkers(); ++I)
+      Workers.push_back(std::make_unique<WorkerState>(&Contents));
+    int ExitCode = analyzeFiles(
+        *Compilations, PreambleDb ? *PreambleDb : *Compilations, Files,
+        Scheduler, Workers, Cache.get(), Preambles.get(), nullptr);
+    errs() << "mir-migrate: file cache: " << Contents.getHits() << " hits, "
+           << Contents.getMisses() << " misses since the server started\n";
+    return ExitCode;
+  }
+
+private:
+  /// Loads the compilation database if it is new or changed since loaded.
+  bool refreshDatabase() {
+    sys::fs::file_status Status;
+    if (std::error_code EC = sys::fs::status(DatabasePath, Status)) {
+      WithColor::error() << DatabasePath << ": " << EC.message() << "\n";
+      return false;
+    }
+    if (Compilations && Status.getLastModificationTime() == DatabaseTime)
+      return true;
+    std::string ErrorMessage;
+    auto Loaded = tooling::JSONCompilationDatabase::loadFromFile(
+        DatabasePath, ErrorMessage, tooling::JSONCommandLineSyntax::AutoDetect);
+    if (!Loaded) {
+      WithColor::error() << ErrorMessage << "\n";
+      return false;
+    }
+    resetPreambles();
+    Compilations = std::move(Loaded);
+    DatabaseTime = Status.getLastModificationTime();
+    return true;
+  }
+
+  /// Evicts changed files from the content cache and brings the shared
+  /// preambles up to date with them.
+  void refreshContents() {
+    std::vector<std::string> Changed = Contents.revalidate();
+    if (!SharePreambles)
+      return;
+    if (Preambles && Checks != PlannedChecks)
+      resetPreambles();
+    if (!Preambles) {
+      if (sys::fs::createUniqueDirectory("mir-preamble", PreambleDir))
+        return;
+      Preambles = std::make_unique<mir::PreambleCache>(
+          *Compilations, PreambleDir.str().str());
+      // Groups of one still pay off once the same TU is checked again.
+      planPreambles(*Preambles, Compilations->getAllFiles(), 1);
+      PreambleDb = std::make_unique<mir::PreambleCompilationDatabase>(
+          *Compilations, *Preambles);
+      PlannedChecks = Checks;
+      return;
+    }
+    ClangTidyContext PlanContext(createOptionsProvider());
+    for (const std::string &File : Changed)
+      if (!Compilations->getCompileCommands(File).empty())
+        Preambles->replan(File, needsProjectHeaders(PlanContext, File));
+    if (unsigned NumStale = Preambles->dropStale())
+      errs() << "mir-migrate: rebuilding " << NumStale
+             << " shared preambles with changed headers\n";
+  }
+
+  void resetPreambles() {
+    if (!Preambles)
+      return;
+    PreambleDb.reset();
+    Preambles.reset();
+    sys::fs::remove(PreambleDir);
+  }
+
+  mir::TuScheduler Scheduler;
+  std::unique_ptr<mir::ResultCache> Cache;
+  bool DefaultFix;
+  std::string DefaultChecks;
+  std::string DefaultExportFixes;
+  std::string DatabasePath;
+  sys::TimePoint<> DatabaseTime;
+  std::unique_ptr<tooling::CompilationDatabase> Compilations;
+  mir::FileContentCache Contents;
+  std::string PlannedChecks;
+  SmallString<128> PreambleDir;
+  std::unique_ptr<mir::PreambleCache> Preambles;
+  std::unique_ptr<mir::PreambleCompilationDatabase> PreambleDb;
+};
+
+/// The -serve mode: answers one mir-client request at a time until the
+/// process is killed, sending each its output and exit code.
+static int runServer(const char *Argv0) {
+  std::string Error;
+  std::unique_ptr<mir::ServerSocket> Socket =
+      mir::ServerSocket::listen(Serve, Error);
+  if (!Socket) {
+    WithColor::error() << Serve << ": " << Error << "\n";
+    return 1;
+  }
+  MigrateServer Server(createResultCache(Argv0));
+  errs() << "mir-migrate: serving on " << Serve << "\n";
+  mir::ServerRequest Request;
+  int Connection;
+  while ((Connection = Socket->accept(Request)) >= 0) {
+    int ExitCode;
+    {
+      mir::RedirectOutput Redirect(Connection);
+      ExitCode = Server.handle(Request);
+    }
+    mir::finishReply(Connection, ExitCode);
+  }
+  WithColor::error() << Serve << ": " << sys::StrError() << "\n";
+  return 1;
+}
+
+/// The -shards mode: balances TUs over machines by predicted analysis time
+/// rather than by count, since a few heavy TUs decide how long a sweep takes.
+static int runShards(const std::vector<std::string> &Files) {
+  mir::TuTimings TimingDb;
+  if (!Timings.empty())
+    TimingDb = mir::TuTimings::load(Timings);
+  mir::IncludeIndex Index = mir::IncludeIndex::load(getIncludeIndexPath());
+  mir::TuCostModel Costs(TimingDb, &Index);
+  std::vector<mir::TuJob> TuJobs;
+  unsigned NumTimed = 0;
+  for (size_t I = 0; I < Files.size(); ++I) {
+    TuJobs.push_back({Files[I], Costs.estimate(Files[I]), I});
+    if (TimingDb.lookup(Files[I]))
+      ++NumTimed;
+  }
+  std::vector<uint64_t> Loads;
+  std::vector<std::vector<size_t>> Assignment =
+      mir::assignShards(TuJobs, Shards, Loads);
+
+  if (std::error_code EC = sys::fs::create_directories(ShardDir)) {
+    WithColor::error() << ShardDir << ": " << EC.message() << "\n";
+    return 1;
+  }
+  for (size_t Shard = 0; Shard < Assignment.size(); ++Shard) {
+    SmallString<256> Path(ShardDir);
+    sys::path::append(Path, "shard-" + Twine(Shard) + ".txt");
+    std::error_code EC;
+    raw_fd_ostream OS(Path, EC, sys::fs::OF_Text);
+    if (EC) {
+      WithColor::error() << Path << ": " << EC.message() << "\n";
+      return 1;
+    }
+    // Database order keeps the lists stable and diffable between runs.
+    llvm::sort(Assignment[Shard]);
+    for (size_t Job : Assignment[Shard])
+      OS << Files[Job] << "\n";
+  }
+
+  errs() << "mir-migrate: " << Files.size() << " TUs in " << Assignment.size()
+         << " shards, " << NumTimed << " with recorded times\n";
+  if (!NumTimed)
+    return 0;
+  // Compare with cutting the database into equal-count chunks.
+  size_t ChunkSize = (Files.size() + Assignment.size() - 1) / Assignment.size();
+  uint64_t Chunk = 0, SlowestChunk = 0;
+  for (size_t I = 0; I < TuJobs.size(); ++I) {
+    Chunk += TuJobs[I].EstimatedCost;
+    if ((I + 1) % ChunkSize == 0 || I + 1 == TuJobs.size()) {
+      SlowestChunk = std::max(SlowestChunk, Chunk);
+      Chunk = 0;
+    }
+  }
+  errs() << format("mir-migrate: predicted slowest shard %.1fs (equal-count "
+                   "chunks: %.1fs)\n",
+                   1e-9 * *std::max_element(Loads.begin(), Loads.end()),
+                   1e-9 * SlowestChunk);
+  return 0;
+}
+
+int main(int argc, const char **argv) {
+  InitLLVM X(argc, argv);
+  cl::HideUnrelatedOptions(MigrateCategory);
+  cl::ParseCommandLineOptions(argc, argv, "mir-* batch migration driver\n");
+  if (!MetricsReport.empty())
+    return mir::printMetricsReport(MetricsReport, MetricsTop, outs()) ? 0 : 1;
+  if (ApplyFixes)
+    return runApplyFixes();
+  if (HeaderGuards)
+    return runHeaderGuards();
+  if (!Serve.empty())
+    return runServer(argv[0]);
+
+  std::string ErrorMessage;
+  std::unique_ptr<tooling::CompilationDatabase> Compilations =
+      tooling::JSONCompilationDatabase::autoDetectFromDirectory(BuildPath,
+                                                                ErrorMessage);
+  if (!Compilations) {
+    WithColor::error() << ErrorMessage << "\n";
+    return 1;
+  }
+
+  std::vector<std::string> Files(SourceFilters.begin(), SourceFilters.end());
+  if (!FileList.empty() && !readLines(FileList, Files))
+    return 1;
+  // The TUs of this shard, before -changed-files narrows them down.
+  std::vector<std::string> ShardFiles;
+  if (!FileList.empty())
+    ShardFiles = Files;
+  if (Files.empty())
+    Files = Compilations->getAllFiles();
+  unsigned NumWorkers =
+      Jobs ? Jobs.getValue() : hardware_concurrency().compute_thread_count();
+  mir::TuScheduler Scheduler(NumWorkers);
+  std::vector<std::unique_ptr<WorkerState>> Workers;
+  for (unsigned I = 0; I < Scheduler.getNumWorkers(); ++I)
+    Workers.push_back(std::make_unique<WorkerState>());
+
+  if (!ChangedFiles.empty()) {
+    std::vector<std::string> Changed;
+    if (!readLines(ChangedFiles, Changed))
+      return 1;
+    std::string Base = getChangedFilesBase();
+    for (std::string &File : Changed)
+      File = normalizePath(Base, File);
+    size_t NumFiles = Files.size();
+    Files = selectAffectedFiles(*Compilations, Files, getIncludeIndexPath(),
+                                Changed, Scheduler, Workers);
+    errs() << "mir-migrate: " << Files.size() << " of " << NumFiles
+           << " TUs affected by " << Changed.size() << " changed files\n";
+  }
+  if (Shards)
+    return runShards(Files);
+
+  std::unique_ptr<mir::ResultCache> Cache = createResultCache(argv[0]);
+
+  SmallString<128> PreambleDir;
+  std::unique_ptr<mir::PreambleCache> Preambles;
+  std::unique_ptr<mir::PreambleCompilationDatabase> PreambleDb;
+  if (SharePreambles &&
+      !sys::fs::createUniqueDirectory("mir-preamble", PreambleDir)) {
+    Preambles = std::make_unique<mir::PreambleCache>(*Compilations,
+                                                     PreambleDir.str().str());
+    planPreambles(*Preambles, Files, PreambleMinGroup);
+    PreambleDb = std::make_unique<mir::PreambleCompilationDatabase>(
+        *Compilations, *Preambles);
+  }
+  // Cache keys and fingerprints always use the original commands; only the
+  // analysis itself sees the shared preambles.
+  std::unique_ptr<mir::TuTimings> TimingDb;
+  if (!Timings.empty())
+    TimingDb = std::make_unique<mir::TuTimings>(mir::TuTimings::load(Timings));
+  int ExitCode = analyzeFiles(*Compilations,
+                              PreambleDb ? *PreambleDb : *Compilations, Files,
+                              Scheduler, Workers, Cache.get(), Preambles.get(),
+                              TimingDb.get());
+  if (Preambles) {
+    PreambleDb.reset();
+    Preambles.reset();
+    sys::fs::remove(PreambleDir);
+  }
+  // A shard writes only its own TUs, so that the files of all shards can be
+  // concatenated without stale copies of each other's TUs. Those it did not
+  // parse, being replayed or skipped, keep the times it loaded.
+  Optional<ArrayRef<std::string>> OnlyFiles;
+  if (!FileList.empty())
+    OnlyFiles = makeArrayRef(ShardFiles);
+  if (TimingDb && !TimingDb->write(Timings, OnlyFiles))
+    WithColor::warning() << "cannot write timings " << Timings << "\n";
+  return ExitCode;
+}
@@ -1,5 +1,5 @@
 
-//===--- ReorderCtorInitializer.cpp - clang-tidy --------------------------===//
+//===--- MoveConstantInitToDeclaration.cpp - clang-tidy -------------------===//
 //
 // Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
 // See https://llvm.org/LICENSE.txt for license information.
@@ -8,42 +8,24 @@
 //===----------------------------------------------------------------------===//
 
 #include "MoveConstantInitToDeclaration.h"
+#include "CheckMetrics.h"
+#include "RecordInitIndex.h"
+#include "ReorderCtorInitializer.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Expr.h"
-#include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/ASTMatchers/ASTMatchers.h"
-#include "clang/Tooling/Tooling.h"
-#include "clang/Tooling/Transformer/RangeSelector.h"
-#include "clang/Tooling/Transformer/RewriteRule.h"
-#include "clang/Tooling/Transformer/Transformer.h"
-#include <algorithm>
-#include <experimental/map>
-#include <iostream>
-#include <llvm-14/llvm/Support/raw_ostream.h>
-#include <sstream>
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "utils.hpp"
 using namespace clang::ast_matchers;
 
 namespace clang {
 namespace tidy {
 namespace modernize {
 
-llvm::StringRef getSourceRangeAsString(SourceManager &Sm,
-                                       const SourceRange &Range) {
-
-  clang::LangOptions Lo;
-  // get the text from lexer including newlines and other formatting?
-
-  auto StartLoc = Sm.getSpellingLoc(Range.getBegin());
-  auto LastTokenLoc = Sm.getSpellingLoc(Range.getEnd());
-  auto EndLoc = clang::Lexer::getLocForEndOfToken(LastTokenLoc, 0, Sm, Lo);
-  auto PrintableRange = clang::SourceRange{StartLoc, EndLoc};
-  auto Str = clang::Lexer::getSourceText(
-      clang::CharSourceRange::getCharRange(PrintableRange), Sm,
-      clang::LangOptions());
-  return Str;
-}
-
 void MoveConstantInitToDeclaration::registerMatchers(MatchFinder *Finder) {
 
   auto Matcher = cxxRecordDecl(isExpansionInMainFile(),
@@ -52,51 +34,69 @@ void MoveConstantInitToDeclaration::registerMatchers(MatchFinder *Finder) {
   Finder->addMatcher(Matcher, this);
 }
 
-template <typename T> bool compare_literal(const T &a, const T &b) {
-  a.getValue().dump();
-  b.getValue().dump();
+namespace {
 
-  return a.getValue() == b.getValue();
+/// The text that initializes \p Init's member in its declaration: a braced
+/// list as written, or ` = expr` for a parenthesized one, which neither
+/// turns a conversion into a narrowing error nor needs a constructor.
+llvm::StringRef getDeclarationInit(const CXXCtorInitializer &Init,
+                                   const FieldDecl &Field,
+                                   const SourceManager &Sm,
+                                   llvm::SmallVectorImpl<char> &Buffer) {
+  const auto &Lo = getSourceTextLangOptions();
+  SourceLocation Member = Init.getMemberLocation();
+  SourceLocation End = Init.getRParenLoc();
+  if (Member.isMacroID() || End.isInvalid() || End.isMacroID())
+    return {};
+  llvm::StringRef Text = Lexer::getSourceText(
+      CharSourceRange::getTokenRange(
+          Lexer::getLocForEndOfToken(Member, 0, Sm, Lo), End),
+      Sm, Lo);
+  Text = Text.trim();
+  if (Text.startswith("{"))
+    return Text;
+  if (!Text.consume_front("(") || !Text.consume_back(")") ||
+      !Field.getType()->isScalarType())
+    return {};
+  Buffer.clear();
+  (" = " + Text.trim()).toVector(Buffer);
+  return {Buffer.data(), Buffer.size()};
 }
 
-template <>
-bool compare_literal(const clang::StringLiteral &a,
-                     const clang::StringLiteral &b) {
-  return a.getString() == b.getString();
+/// The range that removes a constructor's whole initializer list, colon
+/// included.
+CharSourceRange getInitListRange(
+    llvm::ArrayRef<const CXXCtorInitializer *> Written,
+    const SourceManager &Sm) {
+  SourceLocation Begin = Written.front()->getSourceRange().getBegin();
+  SourceLocation End = Written.back()->getSourceRange().getEnd();
+  if (Begin.isMacroID() || End.isMacroID())
+    return {};
+  auto [Fid, Offset] = Sm.getDecomposedLoc(Begin);
+  llvm::StringRef Before = Sm.getBufferData(Fid).take_front(Offset).rtrim();
+  if (!Before.consume_back(":") || Before.endswith(":"))
+    return {};
+  Before = Before.rtrim();
+  return CharSourceRange::getTokenRange(
+      Sm.getComposedLoc(Fid, Before.size()), End);
 }
 
-template <typename T>
-bool compare(llvm::SmallVector<const CXXCtorInitializer *> Inits) {
-  auto head = llvm::cast<T>(Inits.front()->getInit());
-  const bool same_or_none_init_val = [&Inits, &head]() {
-    if (Inits.front()->getMember()->hasInClassInitializer()) {
-      auto InitExpr = Inits.front()->getMember()->getInClassInitializer();
-      // this can be a initializer list, or other kind, we need to match here
-      if (llvm::isa<InitListExpr>(InitExpr)) {
-        auto InitList = llvm::cast<InitListExpr>(InitExpr);
-        if (InitList->getNumInits() == 1) {
-          auto TheInit = InitList->getInit(0);
-          if (llvm::isa<T>(TheInit)) {
-            auto InitValInClass = llvm::cast<T>(TheInit);
-            return compare_literal(*InitValInClass, *head);
-          } else {
-            return false;
-          }
-        } else {
-          return false;
-        }
-      } else {
-        return false;
-      }
-    }
-    return true;
-  }();
-  return std::all_of(std::next(Inits.begin()), Inits.end(),
-                     [head](const auto &val) {
-                       return compare_literal(*head,
-                                              *llvm::cast<T>(val->getInit()));
-                     }) &&
-         same_or_none_init_val;
+} // namespace
+
+const llvm::FoldingSetNodeID *
+MoveConstantInitToDeclaration::getConstant(const Expr &E,
+                                           const ASTContext &Ctx) {
+  auto [It, Inserted] = Constants.try_emplace(&E);
+  if (!Inserted)
+    return It->second.get();
+  Expr::EvalResult Result;
+  if (!E.isValueDependent() && !E.isTypeDependent() &&
+      E.EvaluateAsRValue(Result, Ctx, /*InConstantContext=*/true) &&
+      !Result.HasSideEffects && !Result.HasUndefinedBehavior) {
+    It->second = std::make_unique<llvm::FoldingSetNodeID>();
+    Result.Val.Profile(*It->second);
+  }
+  return It->second.get();
 }
 
 void MoveConstantInitToDeclaration::check(
@@ -105,62 +105,111 @@ void MoveConstantInitToDeclaration::check(
           Result.Nodes.getNodeAs<clang::CXXRecordDecl>(
               "class_with_ctor_init")) {
     clang::SourceManager &Sm = *Result.SourceManager;
-    std::map<FieldDecl *, llvm::SmallVector<const CXXCtorInitializer *>>
-        InitWithLiteral;
-    for (const auto &Ctor : FS->ctors()) {
-      if (Ctor->getNumCtorInitializers() == 0) {
+    const ASTContext &Ctx = *Result.Context;
+    const auto &Analysis = getRecordInitAnalysis(*FS);
+    // Fields whose written initializers all evaluate to the same constant,
+    // which an in-class initializer must agree with.
+    llvm::SmallVector<const FieldDecl *> Moved;
+    llvm::SmallVector<FixItHint, 8> Fixes;
+    llvm::SmallPtrSet<const CXXCtorInitializer *, 8> Removed;
+    for (const auto &[Field, Inits] : Analysis.initsByField()) {
+      if (Field->isBitField() || !Field->getType().isTrivialType(Ctx) ||
+          Field->getLocation().isMacroID()) {
         continue;
       }
-
-      for (const auto Init : Ctor->inits()) {
-        if (Init->isBaseInitializer()) {
-          continue;
-        }
-        if (Init->getSourceOrder() < 0) {
+      const auto *Value = getConstant(*Inits.front()->getInit(), Ctx);
+      if (!Value) {
+        continue;
+      }
+      auto IsSame = [&](const Expr *E) {
+        const auto *Other = getConstant(*E, Ctx);
+        return Other && *Other == *Value;
+      };
+      if (!llvm::all_of(Inits, [&](const auto *Init) {
+            return IsSame(Init->getInit());
+          })) {
+        continue;
+      }
+      if (Field->hasInClassInitializer() &&
+          !IsSame(Field->getInClassInitializer())) {
+        continue;
+      }
+      if (!Field->hasInClassInitializer()) {
+        llvm::SmallString<64> Buffer;
+        llvm::StringRef Text =
+            getDeclarationInit(*Inits.front(), *Field, Sm, Buffer);
+        if (Text.empty()) {
+          mir::noteSuppressedFix();
           continue;
         }
-        if (llvm::isa<clang::IntegerLiteral>(Init->getInit()) ||
-            llvm::isa<clang::StringLiteral>(Init->getInit()) ||
-            llvm::isa<clang::FloatingLiteral>(Init->getInit())) {
-          InitWithLiteral[Init->getMember()].push_back(Init);
-        }
+        Fixes.push_back(FixItHint::CreateInsertion(
+            Lexer::getLocForEndOfToken(Field->getEndLoc(), 0, Sm,
+                                       getSourceTextLangOptions()),
+            Saver.save(Text)));
       }
+      Moved.push_back(Field);
+      Removed.insert(Inits.begin(), Inits.end());
+    }
+    if (Moved.empty()) {
+      return;
     }
-    // filter out cases where there are multiple inits in different constructors
-    // of the same field, and they use a different init value.
-    std::experimental::erase_if(InitWithLiteral, [](const auto &kv) -> bool {
-      auto &[Field, Inits] = kv;
-      if (llvm::isa<IntegerLiteral>(Inits.front()->getInit())) {
-        return !compare<IntegerLiteral>(Inits);
+
+    // The remaining initializers are respelled as a whole, so that no comma
+    // or lone colon is left behind.
+    const CXXCtorInitializer *First = nullptr;
+    for (const auto &Ctor : Analysis.ctors()) {
+      llvm::SmallVector<const CXXCtorInitializer *> Remaining;
+      for (const auto *Init : Ctor.Written) {
+        if (!Removed.count(Init)) {
+          Remaining.push_back(Init);
+        } else if (!First) {
+          First = Init;
+        }
       }
-      if (llvm::isa<clang::StringLiteral>(Inits.front()->getInit())) {
-        return !compare<clang::StringLiteral>(Inits);
+      if (Remaining.size() == Ctor.Written.size()) {
+        continue;
       }
-      if (llvm::isa<clang::FloatingLiteral>(Inits.front()->getInit())) {
-        return !compare<clang::FloatingLiteral>(Inits);
+      if (llvm::any_of(Ctor.Written, [](const auto *Init) {
+            return Init->getSourceRange().getBegin().isMacroID() ||
+                   Init->getSourceRange().getEnd().isMacroID();
+          })) {
+        mir::noteSuppressedFix();
+        return;
       }
-      return false;
-    });
-    // for the remaining pairs in the map emit fixit.
-    for (const auto &[Field, Inits] : InitWithLiteral) {
-      std::stringstream ss;
-      ss << getSourceRangeAsString(Sm, Field->getSourceRange()).str() << "{"
-         << getSourceRangeAsString(Sm,
-                                   (Inits.front()->getInit())->getSourceRange())
-                .str()
-         << "}";
-      auto Diag = diag(Inits.front()->getSourceRange().getBegin(),
-                       "initialise in declaration", DiagnosticIDs::Warning);
-      for (const auto Init : Inits) {
-        Diag << FixItHint::CreateRemoval(Init->getSourceRange());
+      if (!Remaining.empty()) {
+        Fixes.push_back(
+            createInitializerReorderFix(Sm, Saver, Ctor.Written, Remaining));
+        continue;
       }
-      if (!Field->hasInClassInitializer()) {
-        Diag << FixItHint::CreateReplacement(Field->getSourceRange(), ss.str());
+      CharSourceRange Range = getInitListRange(Ctor.Written, Sm);
+      if (Range.isInvalid()) {
+        mir::noteSuppressedFix();
+        return;
       }
+      Fixes.push_back(FixItHint::CreateRemoval(Range));
     }
+
+    SourceTextBuilder Builder(Saver);
+    Builder.appendJoined(
+        llvm::to_vector(llvm::map_range(
+            Moved, [](const FieldDecl *Field) { return Field->getName(); })),
+        ", ");
+    llvm::SmallString<128> Buffer;
+    auto Diag = diag(First->getSourceRange().getBegin(),
+                     "initialise %0 in declaration", DiagnosticIDs::Warning);
+    Diag << Builder.render(Buffer);
+    for (const auto &Fix : Fixes) {
+      Diag << Fix;
+    }
+    mir::noteFixIts(Fixes.size());
   }
 }
 
+void MoveConstantInitToDeclaration::onEndOfTranslationUnit() {
+  Constants.clear();
+  resetRecordInitAnalyses();
+}
+
 } // namespace modernize
 } // namespace tidy
 } // namespace clang
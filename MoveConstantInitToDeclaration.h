@@ -1,5 +1,5 @@
 
-//===--- RosstreamtofmtCheck.h - clang-tidy ---------------------*- C++ -*-===//
+//===--- MoveConstantInitToDeclaration.h - clang-tidy -----------*- C++ -*-===//
 //
 // Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
 // See https://llvm.org/LICENSE.txt for license information.
@@ -11,25 +11,45 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_MOVECONSTANTINITTODECLARATION_H
 
 #include "clang-tidy/ClangTidyCheck.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
+#include <memory>
 
 namespace clang {
 namespace tidy {
 namespace modernize {
 
-/// FIXME: Write a short description.
+/// Moves a member initializer to the member's declaration when every
+/// constructor that initializes the member gives it the same constant, as
+/// far as Expr::EvaluateAsRValue can tell: literals, `true`, `nullptr`,
+/// enumerators, constexpr expressions and braced aggregates alike.
 ///
-/// For the user-facing documentation see:
-/// http://clang.llvm.org/extra/clang-tidy/checks/modernize-RosStreamToFmt.html
+/// Only members of trivial type are moved, whose value was indeterminate in
+/// the constructors that left them out.
 class MoveConstantInitToDeclaration : public ClangTidyCheck {
 public:
   MoveConstantInitToDeclaration(StringRef Name, ClangTidyContext *Context)
       : ClangTidyCheck(Name, Context) {}
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void onEndOfTranslationUnit() override;
+
+private:
+  /// The profile of the value \p E evaluates to, or null if it is not a
+  /// constant. Evaluated once per expression and translation unit.
+  const llvm::FoldingSetNodeID *getConstant(const Expr &E,
+                                            const ASTContext &Ctx);
+
+  llvm::DenseMap<const Expr *, std::unique_ptr<llvm::FoldingSetNodeID>>
+      Constants;
+  llvm::BumpPtrAllocator Arena;
+  llvm::StringSaver Saver{Arena};
 };
 
 } // namespace modernize
 } // namespace tidy
 } // namespace clang
 
-#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_REORDERCTORINITIALIZER_H
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_MOVECONSTANTINITTODECLARATION_H
@@ -0,0 +1,200 @@
+//===--- NodeletSharedPublishCheck.cpp - clang-tidy -----------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "NodeletSharedPublishCheck.h"
+#include "CheckMetrics.h"
+#include "RosMessageTypes.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/STLExtras.h"
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+namespace {
+
+class VarRefCollector : public RecursiveASTVisitor<VarRefCollector> {
+public:
+  explicit VarRefCollector(const VarDecl &Var) : Var(Var) {}
+
+  bool VisitDeclRefExpr(DeclRefExpr *Ref) {
+    if (Ref->getDecl() == &Var)
+      Refs.push_back(Ref);
+    return true;
+  }
+
+  llvm::SmallVector<const DeclRefExpr *, 8> Refs;
+
+private:
+  const VarDecl &Var;
+};
+
+bool isPublish(const CXXMemberCallExpr &Call) {
+  const CXXMethodDecl *Method = Call.getMethodDecl();
+  return Method && Method->getIdentifier() && Method->getName() == "publish" &&
+         Method->getParent()->getQualifiedNameAsString() == "ros::Publisher";
+}
+
+/// The publish call \p Ref is the message of, if any.
+const CXXMemberCallExpr *getPublishOf(const DeclRefExpr &Ref,
+                                      ASTContext &Ctx) {
+  const Expr *E = &Ref;
+  while (true) {
+    auto Parents = Ctx.getParents(*E);
+    if (Parents.size() != 1)
+      return nullptr;
+    if (const auto *Cast = Parents[0].get<ImplicitCastExpr>()) {
+      E = Cast;
+      continue;
+    }
+    const auto *Call = Parents[0].get<CXXMemberCallExpr>();
+    if (Call && Call->getNumArgs() == 1 && Call->getArg(0) == E &&
+        isPublish(*Call))
+      return Call;
+    return nullptr;
+  }
+}
+
+/// Whether \p S runs in a loop nested in \p Scope, where it would see the
+/// message again after publishing it.
+bool isInLoopWithin(const Stmt &S, const Stmt &Scope, ASTContext &Ctx) {
+  const Stmt *Current = &S;
+  while (Current != &Scope) {
+    auto Parents = Ctx.getParents(*Current);
+    if (Parents.size() != 1)
+      return true;
+    Current = Parents[0].get<Stmt>();
+    if (!Current || llvm::isa<ForStmt, WhileStmt, DoStmt, CXXForRangeStmt>(
+                        Current))
+      return true;
+  }
+  return false;
+}
+
+/// Collects the fixes that declare \p Var as a `T::Ptr` to a new message and
+/// dereference its uses. Subscribers in the process share the published
+/// object, so nothing but other publishes may follow the first one.
+bool getSharedPtrFixes(const VarDecl &Var, const CompoundStmt &Scope,
+                       ASTContext &Ctx,
+                       llvm::SmallVectorImpl<FixItHint> &Fixes) {
+  const SourceManager &Sm = Ctx.getSourceManager();
+  const auto *Construct =
+      llvm::dyn_cast_or_null<CXXConstructExpr>(Var.getInit());
+  const TypeSourceInfo *Info = Var.getTypeSourceInfo();
+  if (!Construct || Construct->getNumArgs() != 0 || !Info ||
+      Var.getType().isConstQualified() || Var.getType()->getContainedAutoType())
+    return false;
+  SourceRange TypeRange = Info->getTypeLoc().getSourceRange();
+  SourceRange DeclRange(Var.getBeginLoc(), Var.getEndLoc());
+  if (TypeRange.getBegin().isMacroID() || TypeRange.getEnd().isMacroID() ||
+      DeclRange.getBegin().isMacroID() || DeclRange.getEnd().isMacroID())
+    return false;
+  StringRef TypeText = Lexer::getSourceText(
+      CharSourceRange::getTokenRange(TypeRange), Sm, Ctx.getLangOpts());
+  if (TypeText.empty())
+    return false;
+
+  VarRefCollector Collector(Var);
+  Collector.TraverseStmt(const_cast<CompoundStmt *>(&Scope));
+  llvm::sort(Collector.Refs, [&Sm](const auto *A, const auto *B) {
+    return Sm.isBeforeInTranslationUnit(A->getBeginLoc(), B->getBeginLoc());
+  });
+  bool Published = false;
+  for (const DeclRefExpr *Ref : Collector.Refs) {
+    if (Ref->refersToEnclosingVariableOrCapture() ||
+        Ref->getBeginLoc().isMacroID())
+      return false;
+    if (const auto *Publish = getPublishOf(*Ref, Ctx)) {
+      if (isInLoopWithin(*Publish, Scope, Ctx))
+        return false;
+      Published = true;
+      continue;
+    }
+    if (Published)
+      return false;
+    auto Parents = Ctx.getParents(*Ref);
+    const auto *Member =
+        Parents.size() == 1 ? Parents[0].get<MemberExpr>() : nullptr;
+    if (Member && !Member->isArrow()) {
+      SourceLocation Op = Member->getOperatorLoc();
+      if (Op.isMacroID())
+        return false;
+      Fixes.push_back(FixItHint::CreateReplacement(
+          CharSourceRange::getTokenRange(Op, Op), "->"));
+    } else {
+      Fixes.push_back(FixItHint::CreateInsertion(Ref->getBeginLoc(), "*"));
+    }
+  }
+  if (!Published)
+    return false;
+  Fixes.push_back(FixItHint::CreateReplacement(
+      DeclRange, (TypeText + "::Ptr " + Var.getName() + "(new " + TypeText +
+                  "())")
+                     .str()));
+  return true;
+}
+
+} // namespace
+
+void NodeletSharedPublishCheck::registerMatchers(MatchFinder *Finder) {
+  auto Nodelet = cxxRecordDecl(isDerivedFrom("::nodelet::Nodelet"));
+  auto LocalMessage =
+      varDecl(hasLocalStorage(), unless(parmVarDecl()),
+              hasParent(declStmt(hasSingleDecl(anything()),
+                                 hasParent(compoundStmt().bind("scope")))))
+          .bind("var");
+  Finder->addMatcher(
+      cxxMemberCallExpr(
+          isExpansionInMainFile(), unless(isInTemplateInstantiation()),
+          callee(cxxMethodDecl(hasName("publish"),
+                               ofClass(hasName("::ros::Publisher")))),
+          hasArgument(0, ignoringParenImpCasts(
+                             expr(optionally(declRefExpr(to(LocalMessage))))
+                                 .bind("message"))),
+          hasAncestor(cxxMethodDecl(ofClass(Nodelet))))
+          .bind("publish"),
+      this);
+}
+
+void NodeletSharedPublishCheck::check(const MatchFinder::MatchResult &Result) {
+  const auto *Publish = Result.Nodes.getNodeAs<CXXMemberCallExpr>("publish");
+  const auto *Message = Result.Nodes.getNodeAs<Expr>("message");
+  const auto *Var = Result.Nodes.getNodeAs<VarDecl>("var");
+  const auto *Scope = Result.Nodes.getNodeAs<CompoundStmt>("scope");
+  // Publishing a shared_ptr passes something that is not a message.
+  if (!getRosMessage(Message->getType()) ||
+      (Var && !Reported.insert(Var).second))
+    return;
+
+  llvm::SmallVector<FixItHint, 8> Fixes;
+  if (Var && Scope &&
+      !getSharedPtrFixes(*Var, *Scope, *Result.Context, Fixes))
+    Fixes.clear();
+  auto Diag = diag(Publish->getExprLoc(),
+                   "publishing %0 by value serializes it even for subscribers "
+                   "in this process; publish a shared_ptr to it instead",
+                   DiagnosticIDs::Warning);
+  Diag << Message->getType().getUnqualifiedType();
+  for (const FixItHint &Fix : Fixes)
+    Diag << Fix;
+  if (Fixes.empty())
+    mir::noteSuppressedFix();
+  mir::noteFixIts(Fixes.size());
+}
+
+void NodeletSharedPublishCheck::onEndOfTranslationUnit() { Reported.clear(); }
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
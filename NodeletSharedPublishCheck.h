@@ -0,0 +1,50 @@
+//===--- NodeletSharedPublishCheck.h - clang-tidy ---------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_NODELETSHAREDPUBLISHCHECK_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_NODELETSHAREDPUBLISHCHECK_H
+
+#include "clang-tidy/ClangTidyCheck.h"
+#include "llvm/ADT/DenseSet.h"
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+/// Finds ros::Publisher::publish calls in nodelet::Nodelet subclasses that
+/// pass the message itself rather than a shared_ptr, which serializes it
+/// even for subscribers in the same process. A local message published last
+/// is built in a shared_ptr instead:
+///
+///   std_msgs::String msg;              std_msgs::String::Ptr msg(
+///                                          new std_msgs::String());
+///   msg.data = "hi";             ->    msg->data = "hi";
+///   pub_.publish(msg);                 pub_.publish(msg);
+///
+/// Only when it is default constructed, not used inside a lambda, published
+/// outside any loop it was declared outside of, and only published again
+/// after its first publish, since subscribers in the process then share it.
+/// Other published messages are reported without a fix.
+class NodeletSharedPublishCheck : public ClangTidyCheck {
+public:
+  NodeletSharedPublishCheck(StringRef Name, ClangTidyContext *Context)
+      : ClangTidyCheck(Name, Context) {}
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void onEndOfTranslationUnit() override;
+
+private:
+  /// Locals already reported from one of their publish calls.
+  llvm::DenseSet<const VarDecl *> Reported;
+};
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_NODELETSHAREDPUBLISHCHECK_H
@@ -0,0 +1,490 @@
+//===--- ParamLookupHoistCheck.cpp - clang-tidy ---------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "ParamLookupHoistCheck.h"
+#include "CheckMetrics.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "utils.hpp"
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+namespace {
+
+constexpr StringRef RegistrationNames[] = {"subscribe", "createTimer",
+                                           "createWallTimer",
+                                           "createSteadyTimer"};
+
+bool isCallbackRegistration(const CXXMemberCallExpr &Call) {
+  const CXXMethodDecl *Method = Call.getMethodDecl();
+  return Method && Method->getIdentifier() &&
+         llvm::is_contained(RegistrationNames, Method->getName()) &&
+         Method->getParent()->getQualifiedNameAsString() == "ros::NodeHandle";
+}
+
+bool registersCallback(const Stmt &S) {
+  if (const auto *Call = llvm::dyn_cast<CXXMemberCallExpr>(&S))
+    if (isCallbackRegistration(*Call))
+      return true;
+  return llvm::any_of(S.children(), [](const Stmt *Child) {
+    return Child && registersCallback(*Child);
+  });
+}
+
+/// \p E without implicit nodes and a std::string built from one argument,
+/// as in `std::string("map")` or a literal bound to `const std::string &`.
+const Expr *stripStringConstruction(const Expr &E) {
+  const Expr *Result = E.IgnoreImplicit();
+  if (const auto *Cast = llvm::dyn_cast<CXXFunctionalCastExpr>(Result))
+    Result = Cast->getSubExpr()->IgnoreImplicit();
+  const auto *Construct = llvm::dyn_cast<CXXConstructExpr>(Result);
+  if (Construct && Construct->getNumArgs() >= 1 &&
+      llvm::all_of(llvm::drop_begin(Construct->arguments()),
+                   [](const Expr *Arg) {
+                     return llvm::isa<CXXDefaultArgExpr>(Arg);
+                   }))
+    Result = Construct->getArg(0)->IgnoreImplicit();
+  return Result;
+}
+
+/// Whether a default value evaluates the same at construction as in the
+/// callback.
+bool isConstantDefault(const Expr &Default, const ASTContext &Ctx) {
+  const Expr *E = stripStringConstruction(Default);
+  return llvm::isa<StringLiteral>(E) ||
+         (!E->isValueDependent() && E->isEvaluatable(Ctx));
+}
+
+/// The type of the member caching a parameter of type \p T: the scalars and
+/// strings the parameter server stores, which are cheap to copy out of it.
+std::string getMemberType(QualType T, const ASTContext &Ctx) {
+  QualType Canonical = T.getNonReferenceType().getCanonicalType();
+  if (const auto *Builtin = llvm::dyn_cast<BuiltinType>(Canonical)) {
+    switch (Builtin->getKind()) {
+    case BuiltinType::Bool:
+    case BuiltinType::Int:
+    case BuiltinType::Float:
+    case BuiltinType::Double:
+      return Builtin->getName(Ctx.getPrintingPolicy()).str();
+    default:
+      return {};
+    }
+  }
+  const auto *String = llvm::dyn_cast_or_null<ClassTemplateSpecializationDecl>(
+      Canonical->getAsCXXRecordDecl());
+  if (String && String->isInStdNamespace() &&
+      String->getName() == "basic_string" &&
+      String->getTemplateArgs()[0].getAsType()->isCharType())
+    return "std::string";
+  return {};
+}
+
+/// The member caching \p Key: its last component with a trailing
+/// underscore, so that `~scan/max_range` is cached in `max_range_`.
+std::string getMemberName(StringRef Key) {
+  StringRef Last = Key.substr(Key.find_last_of("/~") + 1);
+  std::string Name;
+  for (char C : Last)
+    Name += llvm::isAlnum(C) ? C : '_';
+  if (Name.empty() || llvm::isDigit(Name.front()))
+    return {};
+  return Name + "_";
+}
+
+/// Whether the node handle \p Call looks the parameter up through can be
+/// named in another method of \p Record.
+bool isHandleOfRecord(const CallExpr &Call, const CXXRecordDecl &Record) {
+  const auto *MemberCall = llvm::dyn_cast<CXXMemberCallExpr>(&Call);
+  if (!MemberCall)
+    return true;
+  const Expr *Object = MemberCall->getImplicitObjectArgument();
+  if (!Object)
+    return false;
+  Object = Object->IgnoreParenImpCasts();
+  if (const auto *Member = llvm::dyn_cast<MemberExpr>(Object)) {
+    const auto *Field = llvm::dyn_cast<FieldDecl>(Member->getMemberDecl());
+    return Field && Field->getParent() == &Record &&
+           llvm::isa<CXXThisExpr>(Member->getBase()->IgnoreParenImpCasts());
+  }
+  // getNodeHandle(), getPrivateNodeHandle() and the like.
+  const auto *Getter = llvm::dyn_cast<CXXMemberCallExpr>(Object);
+  return Getter && Getter->getNumArgs() == 0 &&
+         llvm::isa<CXXThisExpr>(
+             Getter->getImplicitObjectArgument()->IgnoreParenImpCasts());
+}
+
+/// Whether \p Child of \p Loop runs on every iteration: all of it but the
+/// init statement of a for loop.
+bool isRepeatedIn(const Stmt &Loop, const Stmt *Child) {
+  if (const auto *For = llvm::dyn_cast<ForStmt>(&Loop))
+    return Child != For->getInit();
+  if (const auto *Range = llvm::dyn_cast<CXXForRangeStmt>(&Loop))
+    return Child == Range->getBody();
+  return llvm::isa<WhileStmt, DoStmt>(Loop);
+}
+
+/// The function or lambda \p Call is written in, and whether it runs in a
+/// loop there.
+const FunctionDecl *getEnclosingFunction(const CallExpr &Call,
+                                         ASTContext &Ctx, bool &InLoop) {
+  InLoop = false;
+  DynTypedNode Node = DynTypedNode::create(Call);
+  const Stmt *Child = &Call;
+  while (true) {
+    auto Parents = Ctx.getParents(Node);
+    if (Parents.size() != 1)
+      return nullptr;
+    Node = Parents[0];
+    if (const auto *Lambda = Node.get<LambdaExpr>())
+      return Lambda->getCallOperator();
+    if (const auto *Function = Node.get<FunctionDecl>())
+      return Function;
+    const auto *S = Node.get<Stmt>();
+    if (!S)
+      continue;
+    if (isRepeatedIn(*S, Child))
+      InLoop = true;
+    Child = S;
+  }
+}
+
+/// The leading whitespace of the line \p Loc is on.
+StringRef getIndentation(SourceLocation Loc, const SourceManager &Sm) {
+  auto [Fid, Offset] = Sm.getDecomposedLoc(Sm.getExpansionLoc(Loc));
+  StringRef Line = Sm.getBufferData(Fid).take_front(Offset);
+  Line = Line.substr(Line.rfind('\n') + 1);
+  return Line.take_while([](char C) { return C == ' ' || C == '\t'; });
+}
+
+/// Inserts \p Load in \p Init's body before the statement that registers
+/// the first callback, which may run at once, or after its last statement.
+llvm::Optional<FixItHint> getLoadFix(const FunctionDecl &Init, StringRef Load,
+                                     const SourceManager &Sm,
+                                     const LangOptions &Lo) {
+  const auto *Body = llvm::cast<CompoundStmt>(Init.getBody());
+  for (const Stmt *S : Body->body()) {
+    if (!registersCallback(*S))
+      continue;
+    if (S->getBeginLoc().isMacroID())
+      return llvm::None;
+    return FixItHint::CreateInsertion(
+        S->getBeginLoc(),
+        (Load + ";\n" + getIndentation(S->getBeginLoc(), Sm)).str());
+  }
+  if (Body->body_empty()) {
+    if (Body->getLBracLoc().isMacroID())
+      return llvm::None;
+    StringRef Indent = getIndentation(Init.getBeginLoc(), Sm);
+    return FixItHint::CreateInsertion(
+        Body->getLBracLoc().getLocWithOffset(1),
+        ("\n" + Indent + "  " + Load + ";\n" + Indent).str());
+  }
+  const Stmt *Last = Body->body_back();
+  if (Last->getBeginLoc().isMacroID() || Last->getEndLoc().isMacroID())
+    return llvm::None;
+  SourceLocation End = Lexer::getLocForEndOfToken(Last->getEndLoc(), 0, Sm, Lo);
+  auto Next = Lexer::findNextToken(Last->getEndLoc(), Sm, Lo);
+  if (Next && Next->is(tok::semi))
+    End = Next->getEndLoc();
+  return FixItHint::CreateInsertion(
+      End,
+      ("\n" + getIndentation(Last->getBeginLoc(), Sm) + Load + ";").str());
+}
+
+/// Whether \p S loads the parameter \p Key into \p Field as a fix writes
+/// it: `nh_.param("gain", gain_, 0.5)` or `gain_ = nh_.param("gain", 0.5)`.
+bool loadsParam(const Stmt &S, StringRef Key, const FieldDecl &Field) {
+  auto IsField = [&](const Expr *E) {
+    const auto *Member = llvm::dyn_cast<MemberExpr>(E->IgnoreParenImpCasts());
+    return Member && Member->getMemberDecl() == &Field;
+  };
+  auto IsLookup = [&](const Expr *E, unsigned NumArgs) {
+    const auto *Call = llvm::dyn_cast<CallExpr>(E->IgnoreImplicit());
+    const FunctionDecl *Callee = Call ? Call->getDirectCallee() : nullptr;
+    if (!Callee || !Callee->getIdentifier() || Callee->getName() != "param" ||
+        Call->getNumArgs() != NumArgs)
+      return false;
+    const auto *Literal = llvm::dyn_cast<StringLiteral>(
+        stripStringConstruction(*Call->getArg(0)));
+    return Literal && Literal->getCharByteWidth() == 1 &&
+           Literal->getString() == Key &&
+           (NumArgs == 2 || IsField(Call->getArg(1)));
+  };
+  if (const auto *E = llvm::dyn_cast<Expr>(&S)) {
+    if (IsLookup(E, 3))
+      return true;
+    if (const auto *Assign = llvm::dyn_cast<BinaryOperator>(E))
+      if (Assign->getOpcode() == BO_Assign && IsField(Assign->getLHS()) &&
+          IsLookup(Assign->getRHS(), 2))
+        return true;
+    if (const auto *Assign = llvm::dyn_cast<CXXOperatorCallExpr>(E))
+      if (Assign->getOperator() == OO_Equal && IsField(Assign->getArg(0)) &&
+          IsLookup(Assign->getArg(1), 2))
+        return true;
+  }
+  return llvm::any_of(S.children(), [&](const Stmt *Child) {
+    return Child && loadsParam(*Child, Key, Field);
+  });
+}
+
+} // namespace
+
+void ParamLookupHoistCheck::registerMatchers(MatchFinder *Finder) {
+  auto OfNodeHandle = ofClass(hasName("::ros::NodeHandle"));
+  Finder->addMatcher(
+      cxxMemberCallExpr(unless(isInTemplateInstantiation()),
+                        callee(cxxMethodDecl(hasAnyName(RegistrationNames),
+                                             OfNodeHandle)))
+          .bind("registration"),
+      this);
+  Finder->addMatcher(
+      callExpr(isExpansionInMainFile(), unless(isInTemplateInstantiation()),
+               callee(functionDecl(anyOf(
+                   cxxMethodDecl(
+                       hasAnyName("getParam", "getParamCached", "param"),
+                       OfNodeHandle),
+                   hasAnyName("::ros::param::get", "::ros::param::getCached",
+                              "::ros::param::param")))),
+               hasArgument(0, expr().bind("key")))
+          .bind("lookup"),
+      this);
+}
+
+void ParamLookupHoistCheck::collectCallbacks(const Stmt &S,
+                                             CallbackKind Kind) {
+  if (const auto *Lambda = llvm::dyn_cast<LambdaExpr>(&S)) {
+    Callbacks.try_emplace(Lambda->getCallOperator()->getCanonicalDecl(), Kind);
+    return;
+  }
+  if (const auto *Ref = llvm::dyn_cast<DeclRefExpr>(&S)) {
+    if (const auto *Function = llvm::dyn_cast<FunctionDecl>(Ref->getDecl()))
+      Callbacks.try_emplace(Function->getCanonicalDecl(), Kind);
+    return;
+  }
+  // boost::bind(&Node::onScan, this, _1) registers onScan, not bind.
+  const auto *Call = llvm::dyn_cast<CallExpr>(&S);
+  for (const Stmt *Child : S.children())
+    if (Child && (!Call || Child != Call->getCallee()))
+      collectCallbacks(*Child, Kind);
+}
+
+void ParamLookupHoistCheck::check(const MatchFinder::MatchResult &Result) {
+  Context = Result.Context;
+  if (const auto *Registration =
+          Result.Nodes.getNodeAs<CXXMemberCallExpr>("registration")) {
+    CallbackKind Kind =
+        Registration->getMethodDecl()->getName() == "subscribe"
+            ? CallbackKind::Subscription
+            : CallbackKind::Timer;
+    for (const Expr *Arg : Registration->arguments())
+      collectCallbacks(*Arg, Kind);
+    return;
+  }
+  const auto *Call = Result.Nodes.getNodeAs<CallExpr>("lookup");
+  const auto *Key = llvm::dyn_cast<StringLiteral>(
+      stripStringConstruction(*Result.Nodes.getNodeAs<Expr>("key")));
+  // A computed key may differ on every call.
+  if (!Key || Key->getCharByteWidth() != 1)
+    return;
+  bool InLoop;
+  if (const FunctionDecl *Function =
+          getEnclosingFunction(*Call, *Result.Context, InLoop))
+    Lookups.push_back({Call, Function, InLoop, Key->getString()});
+}
+
+const FunctionDecl *
+ParamLookupHoistCheck::getInitializer(const CXXRecordDecl &Record) {
+  auto [It, Inserted] = Initializers.try_emplace(&Record, nullptr);
+  if (!Inserted)
+    return It->second;
+  // A nodelet's node handles only work from onInit on.
+  bool IsNodelet =
+      !Record.forallBases([](const CXXRecordDecl *Base) {
+        return Base->getQualifiedNameAsString() != "nodelet::Nodelet";
+      });
+  const CXXMethodDecl *Found = nullptr;
+  for (const CXXMethodDecl *Method : Record.methods()) {
+    const auto *Ctor = llvm::dyn_cast<CXXConstructorDecl>(Method);
+    bool IsCandidate =
+        IsNodelet ? Method->getIdentifier() && Method->getName() == "onInit"
+                  : Ctor && Ctor->isUserProvided() &&
+                        !Ctor->isCopyOrMoveConstructor();
+    if (!IsCandidate)
+      continue;
+    if (Found)
+      return nullptr;
+    Found = Method;
+  }
+  const FunctionDecl *Definition = nullptr;
+  if (!Found || !Found->hasBody(Definition) ||
+      !llvm::isa<CompoundStmt>(Definition->getBody()) ||
+      !Context->getSourceManager().isInMainFile(
+          Context->getSourceManager().getExpansionLoc(
+              Definition->getBeginLoc())))
+    return nullptr;
+  const auto *Ctor = llvm::dyn_cast<CXXConstructorDecl>(Definition);
+  if (Ctor && Ctor->isDelegatingConstructor())
+    return nullptr;
+  It->second = Definition;
+  return Definition;
+}
+
+bool ParamLookupHoistCheck::getCachingFixes(
+    const Lookup &L, llvm::SmallVectorImpl<FixItHint> &Fixes) {
+  const SourceManager &Sm = Context->getSourceManager();
+  const LangOptions &Lo = getLangOpts();
+  const auto *Method = llvm::dyn_cast<CXXMethodDecl>(L.Function);
+  if (!Method || !Method->isInstance() || Method->getParent()->isLambda())
+    return false;
+  const CXXRecordDecl &Record = *Method->getParent();
+  if (!Sm.isInMainFile(Sm.getExpansionLoc(Record.getLocation())) ||
+      !isHandleOfRecord(*L.Call, Record))
+    return false;
+  const FunctionDecl *Init = getInitializer(Record);
+  if (!Init || Init->getCanonicalDecl() == Method->getCanonicalDecl())
+    return false;
+
+  // nh.param(key, var, default) as a statement, or nh.param(key, default).
+  const Expr *Out = nullptr;
+  const Expr *Default = nullptr;
+  bool IsParam = L.Call->getDirectCallee()->getName() == "param";
+  if (IsParam && L.Call->getNumArgs() == 3 &&
+      isStatementInBlock(*L.Call, *Context)) {
+    Out = L.Call->getArg(1);
+    Default = L.Call->getArg(2);
+    const auto *Ref = llvm::dyn_cast<DeclRefExpr>(Out->IgnoreParenImpCasts());
+    const auto *Var =
+        Ref ? llvm::dyn_cast<VarDecl>(Ref->getDecl()) : nullptr;
+    if (!Var || !Var->isLocalVarDecl() || Var->isStaticLocal())
+      return false;
+  } else if (IsParam && L.Call->getNumArgs() == 2) {
+    Default = L.Call->getArg(1);
+  } else {
+    return false;
+  }
+  std::string Type =
+      getMemberType(Out ? Out->getType() : L.Call->getType(), *Context);
+  std::string Member = getMemberName(L.Key);
+  if (Type.empty() || Member.empty() ||
+      !isConstantDefault(*Default, *Context))
+    return false;
+  for (const Expr *E : {static_cast<const Expr *>(L.Call), Default, Out})
+    if (E && (E->getBeginLoc().isMacroID() || E->getEndLoc().isMacroID()))
+      return false;
+
+  StringRef CallText = getExprAsString(Sm, *L.Call);
+  StringRef DefaultText = getExprAsString(Sm, *Default);
+  auto Existing = Record.lookup(&Context->Idents.get(Member));
+  if (!Existing.empty()) {
+    // A member an earlier run added, which only needs to be read.
+    const auto *Field = llvm::dyn_cast<FieldDecl>(Existing.front());
+    if (!Existing.isSingleResult() || !Field ||
+        getMemberType(Field->getType(), *Context) != Type ||
+        !Field->getInClassInitializer() ||
+        getExprAsString(Sm, *Field->getInClassInitializer()) != DefaultText ||
+        !loadsParam(*Init->getBody(), L.Key, *Field))
+      return false;
+  } else {
+    // Only the lookup that adds the member is fixed: the member and its
+    // load attached to the other diagnostics too would be inserted twice.
+    // The next run turns those into reads of the member.
+    auto [It, Inserted] = Cached.try_emplace({&Record, L.Key.str()});
+    if (!Inserted)
+      return false;
+    // Members added by two diagnostics would be insertions at the same
+    // place, which conflict; further keys are cached by the next run.
+    for (auto Other = Cached.lower_bound({&Record, ""});
+         Other != Cached.end() && Other->first.first == &Record; ++Other)
+      if (!Other->second.empty())
+        return false;
+    const FieldDecl *LastField = nullptr;
+    for (const FieldDecl *Field : Record.fields())
+      LastField = Field;
+    if (!LastField)
+      return false;
+    SourceLocation AfterField = Lexer::findLocationAfterToken(
+        LastField->getEndLoc(), tok::semi, Sm, Lo,
+        /*SkipTrailingWhitespaceAndNewLine=*/false);
+    if (AfterField.isInvalid() || AfterField.isMacroID())
+      return false;
+
+    std::string Load;
+    if (Out) {
+      SourceLocation AfterOut =
+          Lexer::getLocForEndOfToken(Out->getEndLoc(), 0, Sm, Lo);
+      Load = (Lexer::getSourceText(CharSourceRange::getCharRange(
+                                       L.Call->getBeginLoc(),
+                                       Out->getBeginLoc()),
+                                   Sm, Lo) +
+              Member +
+              Lexer::getSourceText(CharSourceRange::getTokenRange(
+                                       AfterOut, L.Call->getEndLoc()),
+                                   Sm, Lo))
+                 .str();
+    } else {
+      Load = (Member + " = " + CallText).str();
+    }
+    llvm::Optional<FixItHint> LoadFix = getLoadFix(*Init, Load, Sm, Lo);
+    if (!LoadFix)
+      return false;
+    Fixes.push_back(FixItHint::CreateInsertion(
+        AfterField, ("\n" + getIndentation(LastField->getBeginLoc(), Sm) +
+                     Type + " " + Member + " = " + DefaultText + ";")
+                        .str()));
+    Fixes.push_back(*LoadFix);
+    It->second = Member;
+  }
+  std::string Replacement =
+      Out ? (getExprAsString(Sm, *Out) + " = " + Member).str() : Member;
+  Fixes.push_back(FixItHint::CreateReplacement(
+      CharSourceRange::getTokenRange(L.Call->getSourceRange()), Replacement));
+  return true;
+}
+
+void ParamLookupHoistCheck::onEndOfTranslationUnit() {
+  for (const Lookup &L : Lookups) {
+    auto Callback = Callbacks.find(L.Function->getCanonicalDecl());
+    if (Callback == Callbacks.end() && !L.InLoop)
+      continue;
+    unsigned Where = Callback == Callbacks.end()                      ? 2
+                     : Callback->second == CallbackKind::Subscription ? 0
+                                                                      : 1;
+    llvm::SmallVector<FixItHint, 4> Fixes;
+    bool Fixed = getCachingFixes(L, Fixes);
+    auto Diag = diag(L.Call->getBeginLoc(),
+                     "parameter '%0' is looked up %select{on every message|"
+                     "on every timer event|on every loop iteration}1; cache "
+                     "it in a member at construction")
+                << L.Key << Where;
+    if (!Fixed) {
+      mir::noteSuppressedFix();
+      continue;
+    }
+    for (const FixItHint &Fix : Fixes)
+      Diag << Fix;
+    mir::noteFixIts(Fixes.size());
+  }
+  Lookups.clear();
+  Callbacks.clear();
+  Initializers.clear();
+  Cached.clear();
+  Context = nullptr;
+}
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,84 @@
+//===--- ParamLookupHoistCheck.h - clang-tidy -------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_PARAMLOOKUPHOISTCHECK_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_PARAMLOOKUPHOISTCHECK_H
+
+#include "clang-tidy/ClangTidyCheck.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+/// Finds parameter lookups with a literal key, through ros::NodeHandle's
+/// getParam, getParamCached and param or their ros::param counterparts, that
+/// run at message rate: in a function or lambda handed to
+/// NodeHandle::subscribe or a create*Timer call, boost::bind included, or in
+/// a loop body. Each one is a parameter server round trip, or a cache lookup
+/// and key resolution, on every message.
+///
+/// A `param` lookup with a constant default, into a local or as a value,
+/// in a method of a class of the main file is cached in a member:
+///
+///   double gain_ = 0.5;                    // added after the last field
+///   Node() { ...; nh_.param("gain", gain_, 0.5); ...; }
+///   void onScan(...) { ...; gain = gain_; ... }
+///
+/// The member is loaded in the class's only user-written constructor, or in
+/// onInit for nodelets, before it registers its first callback. The node
+/// handle must be a member of the class or come from one of its getters.
+/// Only the first lookup of a key is fixed; the others become reads of the
+/// member once it exists and is loaded in the initializer.
+/// getParam lookups keep the variable's value when the parameter is unset,
+/// so they are reported without a fix, as are all others.
+class ParamLookupHoistCheck : public ClangTidyCheck {
+public:
+  ParamLookupHoistCheck(StringRef Name, ClangTidyContext *Context)
+      : ClangTidyCheck(Name, Context) {}
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void onEndOfTranslationUnit() override;
+
+private:
+  enum class CallbackKind { Subscription, Timer };
+
+  struct Lookup {
+    const CallExpr *Call;
+    /// The function or lambda call operator the lookup is written in.
+    const FunctionDecl *Function;
+    bool InLoop;
+    StringRef Key;
+  };
+
+  void collectCallbacks(const Stmt &S, CallbackKind Kind);
+  const FunctionDecl *getInitializer(const CXXRecordDecl &Record);
+  bool getCachingFixes(const Lookup &L,
+                       llvm::SmallVectorImpl<FixItHint> &Fixes);
+
+  ASTContext *Context = nullptr;
+  std::vector<Lookup> Lookups;
+  /// Canonical declarations of the registered callbacks. A callback can be
+  /// registered after its lookups are matched, so they are only reported at
+  /// the end of the TU.
+  llvm::DenseMap<const FunctionDecl *, CallbackKind> Callbacks;
+  llvm::DenseMap<const CXXRecordDecl *, const FunctionDecl *> Initializers;
+  /// The member a fix earlier in the TU caches a record's parameter in, by
+  /// key; empty if that fix could not be made.
+  std::map<std::pair<const CXXRecordDecl *, std::string>, std::string> Cached;
+};
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_PARAMLOOKUPHOISTCHECK_H
@@ -0,0 +1,404 @@
+//===--- PreambleCache.cpp - mir-migrate ----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "PreambleCache.h"
+
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/Preprocessor.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+struct PreambleCache::Group {
+  std::string Directory;
+  /// Compile flags without the compiler, the source file and its outputs.
+  std::vector<std::string> Flags;
+  std::vector<std::string> Includes;
+  bool RequireSystemHeaders = false;
+  unsigned NumMembers = 0;
+  unsigned Index = 0;
+  std::once_flag Built;
+  /// Empty until built, and if the PCH turned out not to be usable.
+  std::string PchPath;
+  std::string HeaderPath;
+  /// Headers in the PCH and their state when it was built.
+  std::vector<std::pair<std::string, llvm::sys::fs::file_status>> Inputs;
+};
+
+namespace {
+
+std::vector<std::string> getFlags(const tooling::CompileCommand &Command) {
+  std::vector<std::string> Flags;
+  llvm::StringRef FileName = llvm::sys::path::filename(Command.Filename);
+  for (size_t I = 1; I < Command.CommandLine.size(); ++I) {
+    StringRef Arg = Command.CommandLine[I];
+    if (Arg == "-o" || Arg == "-MF" || Arg == "-MT" || Arg == "-MQ") {
+      ++I;
+      continue;
+    }
+    if (Arg == "-c" || Arg == Command.Filename ||
+        (!Arg.startswith("-") && llvm::sys::path::filename(Arg) == FileName))
+      continue;
+    Flags.push_back(Arg.str());
+  }
+  return Flags;
+}
+
+class HeaderCollector : public PPCallbacks {
+public:
+  using Headers =
+      std::vector<std::pair<const FileEntry *, SrcMgr::CharacteristicKind>>;
+
+  HeaderCollector(const SourceManager &Sm, Headers &Entered)
+      : Sm(Sm), Entered(Entered) {}
+
+  void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                   SrcMgr::CharacteristicKind FileType,
+                   FileID PrevFID) override {
+    if (Reason != EnterFile)
+      return;
+    FileID Fid = Sm.getFileID(Loc);
+    if (Fid == Sm.getMainFileID())
+      return;
+    if (const FileEntry *Entry = Sm.getFileEntryForID(Fid))
+      Entered.push_back({Entry, FileType});
+  }
+
+private:
+  const SourceManager &Sm;
+  Headers &Entered;
+};
+
+class BuildPreambleAction : public GeneratePCHAction {
+public:
+  BuildPreambleAction(StringRef OutputFile, bool RequireSystemHeaders,
+                      bool &Usable, std::vector<std::string> &Inputs)
+      : OutputFile(OutputFile), RequireSystemHeaders(RequireSystemHeaders),
+        Usable(Usable), Inputs(Inputs) {}
+
+protected:
+  bool BeginInvocation(CompilerInstance &CI) override {
+    CI.getFrontendOpts().OutputFile = OutputFile;
+    return GeneratePCHAction::BeginInvocation(CI);
+  }
+
+  bool BeginSourceFileAction(CompilerInstance &CI) override {
+    CI.getPreprocessor().addPPCallbacks(
+        std::make_unique<HeaderCollector>(CI.getSourceManager(), Entered));
+    return GeneratePCHAction::BeginSourceFileAction(CI);
+  }
+
+  void EndSourceFileAction() override {
+    HeaderSearch &HS =
+        getCompilerInstance().getPreprocessor().getHeaderSearchInfo();
+    for (const auto &[Entry, Kind] : Entered) {
+      if (!HS.isFileMultipleIncludeGuarded(Entry) ||
+          (RequireSystemHeaders && !SrcMgr::isSystem(Kind)))
+        Usable = false;
+      StringRef Name = Entry->tryGetRealPathName();
+      Inputs.push_back((Name.empty() ? Entry->getName() : Name).str());
+    }
+    GeneratePCHAction::EndSourceFileAction();
+  }
+
+private:
+  std::string OutputFile;
+  bool RequireSystemHeaders;
+  bool &Usable;
+  std::vector<std::string> &Inputs;
+  HeaderCollector::Headers Entered;
+};
+
+class BuildPreambleActionFactory : public tooling::FrontendActionFactory {
+public:
+  BuildPreambleActionFactory(StringRef OutputFile, bool RequireSystemHeaders,
+                             bool &Usable, std::vector<std::string> &Inputs)
+      : OutputFile(OutputFile), RequireSystemHeaders(RequireSystemHeaders),
+        Usable(Usable), Inputs(Inputs) {}
+
+  std::unique_ptr<FrontendAction> create() override {
+    return std::make_unique<BuildPreambleAction>(
+        OutputFile, RequireSystemHeaders, Usable, Inputs);
+  }
+
+  bool runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
+                     FileManager *Files,
+                     std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+                     DiagnosticConsumer *DiagConsumer) override {
+    // clang-tidy defines __clang_analyzer__; a PCH built without it would be
+    // rejected by the TUs that use it.
+    Invocation->getPreprocessorOpts().SetUpStaticAnalyzer = true;
+    return FrontendActionFactory::runInvocation(
+        Invocation, Files, std::move(PCHContainerOps), DiagConsumer);
+  }
+
+private:
+  std::string OutputFile;
+  bool RequireSystemHeaders;
+  bool &Usable;
+  std::vector<std::string> &Inputs;
+};
+
+void buildPreamble(PreambleCache::Group &G, StringRef Dir) {
+  llvm::SmallString<128> Header(Dir);
+  llvm::sys::path::append(Header, "preamble-" + llvm::Twine(G.Index) + ".h");
+  {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Header, EC);
+    if (EC)
+      return;
+    for (const auto &Include : G.Includes)
+      OS << "#include " << Include << "\n";
+  }
+  G.HeaderPath = Header.str().str();
+
+  std::string Pch = (llvm::Twine(Header) + "ch").str();
+  std::vector<std::string> Flags = G.Flags;
+  Flags.push_back("-xc++-header");
+  tooling::FixedCompilationDatabase Db(G.Directory, Flags);
+  // A file system of our own: ClangTool changes its working directory.
+  tooling::ClangTool Tool(Db, {G.HeaderPath},
+                          std::make_shared<PCHContainerOperations>(),
+                          llvm::vfs::createPhysicalFileSystem());
+  IgnoringDiagConsumer IgnoreDiagnostics;
+  Tool.setDiagnosticConsumer(&IgnoreDiagnostics);
+  bool Usable = true;
+  std::vector<std::string> Inputs;
+  BuildPreambleActionFactory Factory(Pch, G.RequireSystemHeaders, Usable,
+                                     Inputs);
+  if (Tool.run(&Factory) != 0 || !Usable) {
+    llvm::sys::fs::remove(Pch);
+    return;
+  }
+  G.PchPath = Pch;
+  for (const std::string &Input : Inputs) {
+    llvm::SmallString<256> Path(Input);
+    llvm::sys::fs::make_absolute(G.Directory, Path);
+    llvm::sys::fs::file_status Status;
+    if (!llvm::sys::fs::status(Path, Status))
+      G.Inputs.push_back({Path.str().str(), Status});
+  }
+}
+
+/// Whether \p Path no longer matches \p Built.
+bool hasChanged(StringRef Path, const llvm::sys::fs::file_status &Built) {
+  llvm::sys::fs::file_status Now;
+  return llvm::sys::fs::status(Path, Now) ||
+         Now.getLastModificationTime() != Built.getLastModificationTime() ||
+         Now.getSize() != Built.getSize() ||
+         Now.getUniqueID() != Built.getUniqueID();
+}
+
+} // namespace
+
+std::vector<std::string> scanLeadingAngleIncludes(StringRef Buffer) {
+  std::vector<std::string> Includes;
+  bool InBlockComment = false;
+  while (!Buffer.empty()) {
+    StringRef Line;
+    std::tie(Line, Buffer) = Buffer.split('\n');
+    Line = Line.trim();
+    if (InBlockComment) {
+      size_t End = Line.find("*/");
+      if (End == StringRef::npos)
+        continue;
+      InBlockComment = false;
+      Line = Line.drop_front(End + 2).trim();
+    }
+    if (Line.startswith("/*")) {
+      size_t End = Line.find("*/", 2);
+      if (End == StringRef::npos) {
+        InBlockComment = true;
+        continue;
+      }
+      Line = Line.drop_front(End + 2).trim();
+    }
+    if (Line.empty() || Line.startswith("//"))
+      continue;
+    if (!Line.consume_front("#"))
+      break;
+    Line = Line.ltrim();
+    if (!Line.consume_front("include"))
+      break;
+    Line = Line.ltrim();
+    size_t Close = Line.find('>');
+    if (!Line.startswith("<") || Close == StringRef::npos)
+      break;
+    Includes.push_back(Line.take_front(Close + 1).str());
+  }
+  return Includes;
+}
+
+PreambleCache::PreambleCache(const tooling::CompilationDatabase &Compilations,
+                             std::string Dir)
+    : Compilations(Compilations), Dir(std::move(Dir)) {}
+
+PreambleCache::~PreambleCache() {
+  for (const auto &G : Groups) {
+    if (!G->PchPath.empty())
+      llvm::sys::fs::remove(G->PchPath);
+    if (!G->HeaderPath.empty())
+      llvm::sys::fs::remove(G->HeaderPath);
+  }
+}
+
+std::unique_ptr<PreambleCache::Group>
+PreambleCache::makeCandidate(StringRef File, bool NeedsProjectHeaders,
+                             std::string &Key) const {
+  std::vector<tooling::CompileCommand> Commands =
+      Compilations.getCompileCommands(File);
+  // Files compiled several ways would need one PCH per command.
+  if (Commands.size() != 1)
+    return nullptr;
+  auto Buffer = llvm::MemoryBuffer::getFile(File);
+  if (!Buffer)
+    return nullptr;
+  std::vector<std::string> Includes =
+      scanLeadingAngleIncludes((*Buffer)->getBuffer());
+  if (Includes.empty())
+    return nullptr;
+
+  std::vector<std::string> Flags = getFlags(Commands.front());
+  Key.clear();
+  llvm::raw_string_ostream OS(Key);
+  OS << Commands.front().Directory << '\0' << llvm::join(Flags, "\1")
+     << '\0' << llvm::join(Includes, "\1") << '\0' << NeedsProjectHeaders;
+  OS.flush();
+  auto G = std::make_unique<Group>();
+  G->Directory = Commands.front().Directory;
+  G->Flags = std::move(Flags);
+  G->Includes = std::move(Includes);
+  G->RequireSystemHeaders = NeedsProjectHeaders;
+  return G;
+}
+
+void PreambleCache::plan(
+    llvm::ArrayRef<std::string> Files, unsigned MinGroupSize,
+    llvm::function_ref<bool(StringRef File)> NeedsProjectHeaders) {
+  this->MinGroupSize = MinGroupSize;
+  llvm::StringMap<std::unique_ptr<Group>> Candidates;
+  std::vector<std::pair<StringRef, Group *>> Assignments;
+  for (const auto &File : Files) {
+    std::string Key;
+    std::unique_ptr<Group> Candidate =
+        makeCandidate(File, NeedsProjectHeaders(File), Key);
+    if (!Candidate)
+      continue;
+    auto &G = Candidates[Key];
+    if (!G)
+      G = std::move(Candidate);
+    ++G->NumMembers;
+    Assignments.push_back({File, G.get()});
+  }
+
+  for (const auto &[File, G] : Assignments)
+    if (G->NumMembers >= MinGroupSize)
+      GroupOfFile[File] = G;
+  for (auto &Entry : Candidates) {
+    if (Entry.second->NumMembers < MinGroupSize)
+      continue;
+    Entry.second->Index = Groups.size();
+    GroupOfKey[Entry.getKey()] = Entry.second.get();
+    Groups.push_back(std::move(Entry.second));
+  }
+}
+
+void PreambleCache::replan(StringRef File, bool NeedsProjectHeaders) {
+  GroupOfFile.erase(File);
+  std::string Key;
+  std::unique_ptr<Group> Candidate =
+      makeCandidate(File, NeedsProjectHeaders, Key);
+  if (!Candidate)
+    return;
+  Group *&G = GroupOfKey[Key];
+  if (!G) {
+    if (MinGroupSize > 1) {
+      GroupOfKey.erase(Key);
+      return;
+    }
+    Candidate->Index = Groups.size();
+    G = Candidate.get();
+    Groups.push_back(std::move(Candidate));
+  }
+  ++G->NumMembers;
+  GroupOfFile[File] = G;
+}
+
+std::string PreambleCache::getPch(StringRef File) {
+  auto It = GroupOfFile.find(File);
+  if (It == GroupOfFile.end())
+    return "";
+  Group &G = *It->second;
+  std::call_once(G.Built, [&] { buildPreamble(G, Dir); });
+  return G.PchPath;
+}
+
+unsigned PreambleCache::dropStale() {
+  unsigned NumDropped = 0;
+  for (size_t I = 0, E = Groups.size(); I < E; ++I) {
+    Group &Old = *Groups[I];
+    if (Old.PchPath.empty() ||
+        llvm::none_of(Old.Inputs, [](const auto &Input) {
+          return hasChanged(Input.first, Input.second);
+        }))
+      continue;
+    auto Fresh = std::make_unique<Group>();
+    Fresh->Directory = Old.Directory;
+    Fresh->Flags = Old.Flags;
+    Fresh->Includes = Old.Includes;
+    Fresh->RequireSystemHeaders = Old.RequireSystemHeaders;
+    Fresh->NumMembers = Old.NumMembers;
+    Fresh->Index = Groups.size();
+    for (auto &Entry : GroupOfKey)
+      if (Entry.second == &Old)
+        Entry.second = Fresh.get();
+    for (auto &Entry : GroupOfFile)
+      if (Entry.second == &Old)
+        Entry.second = Fresh.get();
+    // The old group stays allocated but owns no files any more.
+    llvm::sys::fs::remove(Old.PchPath);
+    Old.PchPath.clear();
+    Old.Inputs.clear();
+    Groups.push_back(std::move(Fresh));
+    ++NumDropped;
+  }
+  return NumDropped;
+}
+
+std::vector<tooling::CompileCommand>
+PreambleCompilationDatabase::getCompileCommands(StringRef FilePath) const {
+  std::vector<tooling::CompileCommand> Commands =
+      Base.getCompileCommands(FilePath);
+  std::string Pch = Preambles.getPch(FilePath);
+  if (Pch.empty())
+    return Commands;
+  for (auto &Command : Commands) {
+    if (Command.CommandLine.empty())
+      continue;
+    Command.CommandLine.insert(Command.CommandLine.begin() + 1,
+                               {"-include-pch", Pch});
+  }
+  return Commands;
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,107 @@
+//===--- PreambleCache.h - mir-migrate --------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_PREAMBLECACHE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_PREAMBLECACHE_H
+
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+/// Returns the `#include <...>` directives (without `#include`) that open
+/// \p Buffer, skipping blank lines and comments. Scanning stops at the first
+/// other line, including quoted includes, which usually name project headers.
+std::vector<std::string> scanLeadingAngleIncludes(StringRef Buffer);
+
+/// Shares one precompiled header between translation units that start with
+/// the same angle-bracket includes and are compiled with the same flags.
+///
+/// A group's PCH is built on first use and only used if every header in it is
+/// include-guarded (so re-including it from the TU is a no-op, exactly as
+/// without the PCH) and, when the group's TUs are checked with
+/// mir-headercheck, a system header (which that check never looks at).
+/// Otherwise the TUs are parsed cold.
+class PreambleCache {
+public:
+  PreambleCache(const tooling::CompilationDatabase &Compilations,
+                std::string Dir);
+  ~PreambleCache();
+
+  /// Forms groups of at least \p MinGroupSize files. \p NeedsProjectHeaders
+  /// tells whether a file is checked by anything that looks at non-main-file
+  /// headers.
+  void plan(llvm::ArrayRef<std::string> Files, unsigned MinGroupSize,
+            llvm::function_ref<bool(StringRef File)> NeedsProjectHeaders);
+
+  /// Moves \p File, whose contents changed, to the group its includes now
+  /// select. A new group is only formed if the plan allowed groups of one.
+  /// Not thread-safe.
+  void replan(StringRef File, bool NeedsProjectHeaders);
+
+  /// Returns the PCH to use for \p File, building it on first request, or an
+  /// empty string if \p File should be parsed without one. Thread-safe.
+  std::string getPch(StringRef File);
+
+  /// Replaces every built group one of whose headers changed since its PCH
+  /// was built by a fresh group that is built on next use, and returns how
+  /// many there were. Not thread-safe.
+  unsigned dropStale();
+
+  unsigned getNumGroups() const { return Groups.size(); }
+
+  struct Group;
+
+private:
+  /// The group \p File would join, not yet registered, and its key.
+  std::unique_ptr<Group> makeCandidate(StringRef File,
+                                       bool NeedsProjectHeaders,
+                                       std::string &Key) const;
+
+  const tooling::CompilationDatabase &Compilations;
+  std::string Dir;
+  unsigned MinGroupSize = 2;
+  std::vector<std::unique_ptr<Group>> Groups;
+  llvm::StringMap<Group *> GroupOfKey;
+  llvm::StringMap<Group *> GroupOfFile;
+};
+
+/// Compilation database that passes `-include-pch` for files with a shared
+/// preamble.
+class PreambleCompilationDatabase : public tooling::CompilationDatabase {
+public:
+  PreambleCompilationDatabase(const tooling::CompilationDatabase &Base,
+                              PreambleCache &Preambles)
+      : Base(Base), Preambles(Preambles) {}
+
+  std::vector<tooling::CompileCommand>
+  getCompileCommands(StringRef FilePath) const override;
+  std::vector<std::string> getAllFiles() const override {
+    return Base.getAllFiles();
+  }
+  std::vector<tooling::CompileCommand> getAllCompileCommands() const override {
+    return Base.getAllCompileCommands();
+  }
+
+private:
+  const tooling::CompilationDatabase &Base;
+  PreambleCache &Preambles;
+};
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_PREAMBLECACHE_H
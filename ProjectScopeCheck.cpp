@@ -0,0 +1,110 @@
+//===--- ProjectScopeCheck.cpp - clang-tidy -------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "ProjectScopeCheck.h"
+#include "clang-tidy/utils/OptionsUtils.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/VirtualFileSystem.h"
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+namespace {
+
+/// \p Path made absolute against the compile command's directory, without
+/// dots or a trailing separator.
+std::string normalize(StringRef Path, const SourceManager &Sm) {
+  llvm::SmallString<256> Result(Path);
+  Sm.getFileManager().getVirtualFileSystem().makeAbsolute(Result);
+  llvm::sys::path::remove_dots(Result, /*remove_dot_dot=*/true);
+  while (Result.size() > 1 && llvm::sys::path::is_separator(Result.back()))
+    Result.pop_back();
+  return Result.str().str();
+}
+
+bool isWithin(StringRef Path, StringRef Dir) {
+  return Path.consume_front(Dir) &&
+         (Path.empty() || llvm::sys::path::is_separator(Path.front()));
+}
+
+} // namespace
+
+ProjectScopeCheck::ProjectScopeCheck(StringRef Name,
+                                     ClangTidyContext *Context)
+    : ClangTidyCheck(Name, Context),
+      RawProjectPaths(Options.getLocalOrGlobal("ProjectPaths", "")) {}
+
+void ProjectScopeCheck::storeOptions(ClangTidyOptions::OptionMap &Opts) {
+  Options.store(Opts, "ProjectPaths", RawProjectPaths);
+}
+
+void ProjectScopeCheck::registerMatchers(MatchFinder *Finder) {
+  // Without project paths the check is inert, so enabling mir-* does not
+  // change what other checks see.
+  if (RawProjectPaths.empty())
+    return;
+  // The TU is matched before its children are traversed, so the scope set
+  // here already applies to this traversal.
+  Finder->addMatcher(translationUnitDecl().bind("tu"), this);
+}
+
+bool ProjectScopeCheck::isInProject(FileID File, const SourceManager &Sm) {
+  auto Cached = InProject.find(File);
+  if (Cached != InProject.end())
+    return Cached->second;
+  bool Result = false;
+  if (auto Entry = Sm.getFileEntryRefForID(File)) {
+    std::string Path = normalize(Entry->getName(), Sm);
+    Result = llvm::any_of(ProjectPaths, [&](const std::string &Dir) {
+      return isWithin(Path, Dir);
+    });
+  }
+  InProject[File] = Result;
+  return Result;
+}
+
+void ProjectScopeCheck::check(const MatchFinder::MatchResult &Result) {
+  const auto *TU = Result.Nodes.getNodeAs<TranslationUnitDecl>("tu");
+  if (!TU)
+    return;
+  const SourceManager &Sm = *Result.SourceManager;
+  ProjectPaths.clear();
+  for (StringRef Dir : utils::options::parseStringList(RawProjectPaths))
+    if (!Dir.trim().empty())
+      ProjectPaths.push_back(normalize(Dir.trim(), Sm));
+
+  std::vector<Decl *> Kept;
+  for (Decl *D : TU->decls()) {
+    // Builtins and other implicit declarations have no location.
+    SourceLocation Loc = D->getBeginLoc();
+    if (Loc.isInvalid())
+      continue;
+    FileID File = Sm.getFileID(Sm.getExpansionLoc(Loc));
+    if (File == Sm.getMainFileID() || isInProject(File, Sm))
+      Kept.push_back(D);
+  }
+  Result.Context->setTraversalScope(Kept);
+  Scoped = Result.Context;
+}
+
+void ProjectScopeCheck::onEndOfTranslationUnit() {
+  if (!Scoped)
+    return;
+  Scoped->setTraversalScope({Scoped->getTranslationUnitDecl()});
+  Scoped = nullptr;
+}
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,53 @@
+//===--- ProjectScopeCheck.h - clang-tidy -----------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_PROJECTSCOPECHECK_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_PROJECTSCOPECHECK_H
+
+#include "clang-tidy/ClangTidyCheck.h"
+#include "llvm/ADT/DenseMap.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+/// Emits nothing. When the `ProjectPaths` option lists path prefixes, it
+/// limits the AST traversal of every matcher in the run to the top-level
+/// declarations written in the main file or below one of those paths, so
+/// that declarations from ros/ros.h, Boost and the standard library are not
+/// visited only to be rejected by isExpansionInMainFile().
+///
+/// Pruned declarations stay reachable through the AST: a check that follows
+/// a base class, a callee or a type into a system header still sees its
+/// definition. Only matching starts at fewer nodes, and parent lookups stop
+/// at the kept top-level declarations. The scope is restored at the end of
+/// the TU, before the static analyzer runs.
+class ProjectScopeCheck : public ClangTidyCheck {
+public:
+  ProjectScopeCheck(StringRef Name, ClangTidyContext *Context);
+  void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void onEndOfTranslationUnit() override;
+
+private:
+  bool isInProject(FileID File, const SourceManager &Sm);
+
+  const std::string RawProjectPaths;
+  std::vector<std::string> ProjectPaths;
+  llvm::DenseMap<FileID, bool> InProject;
+  ASTContext *Scoped = nullptr;
+};
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_PROJECTSCOPECHECK_H
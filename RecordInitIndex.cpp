@@ -0,0 +1,103 @@
+//===--- RecordInitIndex.cpp - clang-tidy ---------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "RecordInitIndex.h"
+
+#include "clang/AST/ASTContext.h"
+#include "llvm/ADT/STLExtras.h"
+#include <memory>
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+namespace {
+
+struct AnalysisCache {
+  const ASTContext *Context = nullptr;
+  llvm::DenseMap<const CXXRecordDecl *, std::unique_ptr<RecordInitAnalysis>>
+      Records;
+};
+
+// mir-migrate runs translation units on several threads.
+thread_local AnalysisCache Cache;
+
+} // namespace
+
+RecordInitAnalysis::RecordInitAnalysis(const CXXRecordDecl &Record) {
+  unsigned Index = 0;
+  for (const auto *Field : Record.fields())
+    FieldIndex[Field] = Index++;
+
+  llvm::DenseMap<const FieldDecl *,
+                 llvm::SmallVector<const CXXCtorInitializer *, 2>>
+      ByField;
+  for (const auto *Ctor : Record.ctors()) {
+    CtorInits Inits{Ctor, {}, {}};
+    for (const auto *Init : Ctor->inits())
+      if (Init->isWritten())
+        Inits.Written.push_back(Init);
+    // Sema stores initializers in initialization order; restore the order
+    // they were spelled in.
+    llvm::sort(Inits.Written, [](const auto *A, const auto *B) {
+      return A->getSourceOrder() < B->getSourceOrder();
+    });
+
+    llvm::SmallVector<const CXXCtorInitializer *> Members;
+    bool Reorderable = true;
+    for (const auto *Init : Inits.Written) {
+      if (Init->isBaseInitializer()) {
+        Inits.InDeclarationOrder.push_back(Init);
+      } else if (const FieldDecl *Field = Init->getMember()) {
+        Members.push_back(Init);
+        ByField[Field].push_back(Init);
+      } else {
+        // Delegating and indirect (anonymous union) initializers have no
+        // field position to sort by.
+        Reorderable = false;
+      }
+    }
+    if (Inits.Written.empty())
+      continue;
+    if (Reorderable) {
+      llvm::sort(Members, [this](const auto *A, const auto *B) {
+        return getFieldIndex(A->getMember()) < getFieldIndex(B->getMember());
+      });
+      Inits.InDeclarationOrder.append(Members.begin(), Members.end());
+    } else {
+      Inits.InDeclarationOrder = Inits.Written;
+    }
+    Ctors.push_back(std::move(Inits));
+  }
+
+  for (const auto *Field : Record.fields()) {
+    auto It = ByField.find(Field);
+    if (It != ByField.end())
+      InitsByField.insert({Field, std::move(It->second)});
+  }
+}
+
+const RecordInitAnalysis &getRecordInitAnalysis(const CXXRecordDecl &Record) {
+  if (Cache.Context != &Record.getASTContext()) {
+    Cache.Records.clear();
+    Cache.Context = &Record.getASTContext();
+  }
+  auto &Entry = Cache.Records[&Record];
+  if (!Entry)
+    Entry = std::make_unique<RecordInitAnalysis>(Record);
+  return *Entry;
+}
+
+void resetRecordInitAnalyses() {
+  Cache.Records.clear();
+  Cache.Context = nullptr;
+}
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,74 @@
+//===--- RecordInitIndex.h - clang-tidy -------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_RECORDINITINDEX_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_RECORDINITINDEX_H
+
+#include "clang/AST/DeclCXX.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+/// Fields and constructor initializers of one record, gathered in a single
+/// pass and shared by every check that rewrites member initialization.
+class RecordInitAnalysis {
+public:
+  struct CtorInits {
+    const CXXConstructorDecl *Ctor;
+    /// Written initializers, bases and members, in source order.
+    llvm::SmallVector<const CXXCtorInitializer *> Written;
+    /// The written initializers as they should be spelled: bases in written
+    /// order, then members in field declaration order.
+    llvm::SmallVector<const CXXCtorInitializer *> InDeclarationOrder;
+
+    bool isInDeclarationOrder() const { return Written == InDeclarationOrder; }
+  };
+
+  explicit RecordInitAnalysis(const CXXRecordDecl &Record);
+
+  /// Position of \p Field among the record's fields.
+  unsigned getFieldIndex(const FieldDecl *Field) const {
+    return FieldIndex.lookup(Field);
+  }
+
+  /// Constructors with at least one written initializer.
+  llvm::ArrayRef<CtorInits> ctors() const { return Ctors; }
+
+  /// Written member initializers grouped by field, fields in declaration
+  /// order and initializers in constructor order.
+  const llvm::MapVector<const FieldDecl *,
+                        llvm::SmallVector<const CXXCtorInitializer *, 2>> &
+  initsByField() const {
+    return InitsByField;
+  }
+
+private:
+  llvm::DenseMap<const FieldDecl *, unsigned> FieldIndex;
+  llvm::SmallVector<CtorInits, 2> Ctors;
+  llvm::MapVector<const FieldDecl *,
+                  llvm::SmallVector<const CXXCtorInitializer *, 2>>
+      InitsByField;
+};
+
+/// Returns the analysis of \p Record, building it on first use. Entries are
+/// kept per thread until resetRecordInitAnalyses() is called, which checks
+/// using them do at the end of every translation unit.
+const RecordInitAnalysis &getRecordInitAnalysis(const CXXRecordDecl &Record);
+
+void resetRecordInitAnalyses();
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_RECORDINITINDEX_H
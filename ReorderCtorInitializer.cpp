@@ -8,9 +8,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "ReorderCtorInitializer.h"
-
-#include <iostream>
-#include <sstream>
+#include "CheckMetrics.h"
+#include "RecordInitIndex.h"
 
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/RecursiveASTVisitor.h"
@@ -20,6 +19,7 @@
 #include "clang/Tooling/Transformer/RangeSelector.h"
 #include "clang/Tooling/Transformer/RewriteRule.h"
 #include "clang/Tooling/Transformer/Transformer.h"
+#include "llvm/ADT/SmallString.h"
 #include "utils.hpp"
 
 using namespace clang::ast_matchers;
@@ -40,70 +40,44 @@ void ReorderCtorInitializer::check(const MatchFinder::MatchResult &Result) {
           Result.Nodes.getNodeAs<clang::CXXRecordDecl>(
               "class_with_ctor_init")) {
     clang::SourceManager &Sm = *Result.SourceManager;
-    for (const auto &Ctor : FS->ctors()) {
-      if (Ctor->getNumCtorInitializers() == 0) {
+    const auto &Analysis = getRecordInitAnalysis(*FS);
+    for (const auto &Ctor : Analysis.ctors()) {
+      if (Ctor.isInDeclarationOrder()) {
         continue;
       }
-
-      std::map<int, const CXXCtorInitializer *> InitOrder;
-      llvm::SmallVector<const CXXCtorInitializer *> BaseInitializers;
-      for (const auto Init : Ctor->inits()) {
-        if (Init->isBaseInitializer()) {
-          BaseInitializers.push_back(Init);
-        }
-        if (Init->getSourceOrder() < 0) {
-          continue;
-        }
-        InitOrder[Init->getSourceOrder()] = Init;
-      }
-      std::map<int, const CXXCtorInitializer *> FieldOrder;
-      int FieldOrderIndex = 0;
-      for (const auto Field : FS->fields()) {
-        for (const auto &[Order, Init] : InitOrder) {
-          if (Order < 0) {
-            continue;
-          }
-          if (Field == Init->getMember()) {
-            FieldOrder[FieldOrderIndex] = Init;
-          }
-        }
-        ++FieldOrderIndex;
-      }
-      // compare the two maps
-      if (FieldOrder != InitOrder) {
-        // we have a mismatch
-        // emit fixit with new order.
-        // the fixit is constructed by copying source ranges in the right order
-        // :)
-        llvm::SmallVector<llvm::StringRef> Ordering;
-        for (const auto &BaseInits : BaseInitializers) {
-          Ordering.push_back(getExprAsString(Sm, *BaseInits));
-        }
-        for (const auto &[Order, Init] : FieldOrder) {
-          Ordering.push_back(getExprAsString(Sm, *Init));
-        }
-        std::stringstream Ss;
-        int Cnt = 0;
-        for (const auto &Str : Ordering) {
-          Ss << Str.str();
-          ++Cnt;
-          if (Cnt != Ordering.size()) {
-            Ss << ", ";
-          }
-        }
-
-        auto FormatString = Ss.str();
-        auto Begin = InitOrder[0]->getSourceRange().getBegin();
-        auto End = InitOrder[InitOrder.size() - 1]->getSourceRange().getEnd();
-        auto Diag = diag(Begin, "Write in field declaration order instead",
-                         DiagnosticIDs::Warning);
-        Diag << FixItHint::CreateReplacement(SourceRange{Begin, End},
-                                             FormatString);
-      }
+      auto Begin = Ctor.Written.front()->getSourceRange().getBegin();
+      diag(Begin, "Write in field declaration order instead",
+           DiagnosticIDs::Warning)
+          << createInitializerReorderFix(Sm, Saver, Ctor.Written,
+                                         Ctor.InDeclarationOrder);
+      mir::noteFixIts(1);
     }
   }
 }
 
+FixItHint createInitializerReorderFix(
+    const SourceManager &Sm, llvm::StringSaver &Saver,
+    llvm::ArrayRef<const CXXCtorInitializer *> Written,
+    llvm::ArrayRef<const CXXCtorInitializer *> Ordered) {
+  // the fixit is constructed by copying source ranges in the right order
+  // :)
+  llvm::SmallVector<llvm::StringRef> Ordering;
+  for (const auto *Init : Ordered) {
+    Ordering.push_back(getExprAsString(Sm, *Init));
+  }
+  SourceTextBuilder Builder(Saver);
+  Builder.appendJoined(Ordering, ", ");
+  llvm::SmallString<256> Buffer;
+  auto Begin = Written.front()->getSourceRange().getBegin();
+  auto End = Written.back()->getSourceRange().getEnd();
+  return FixItHint::CreateReplacement(SourceRange{Begin, End},
+                                      Builder.render(Buffer));
+}
+
+void ReorderCtorInitializer::onEndOfTranslationUnit() {
+  resetRecordInitAnalyses();
+}
+
 }  // namespace modernize
 }  // namespace tidy
 }  // namespace clang
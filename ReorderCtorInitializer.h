@@ -11,6 +11,9 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_REORDERCTORINITIALIZER_H
 
 #include "clang-tidy/ClangTidyCheck.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
 
 namespace clang {
 namespace tidy {
@@ -26,8 +29,20 @@ public:
       : ClangTidyCheck(Name, Context) {}
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void onEndOfTranslationUnit() override;
+
+private:
+  llvm::BumpPtrAllocator Arena;
+  llvm::StringSaver Saver{Arena};
 };
 
+/// Replaces the written initializer list \p Written with the same
+/// initializers spelled in the order \p Ordered.
+FixItHint createInitializerReorderFix(
+    const SourceManager &Sm, llvm::StringSaver &Saver,
+    llvm::ArrayRef<const CXXCtorInitializer *> Written,
+    llvm::ArrayRef<const CXXCtorInitializer *> Ordered);
+
 } // namespace modernize
 } // namespace tidy
 } // namespace clang
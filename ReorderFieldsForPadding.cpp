@@ -0,0 +1,431 @@
+//===--- ReorderFieldsForPadding.cpp - clang-tidy -------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "ReorderFieldsForPadding.h"
+#include "CheckMetrics.h"
+#include "RecordInitIndex.h"
+#include "ReorderCtorInitializer.h"
+
+#include "clang-tidy/utils/LexerUtils.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Attr.h"
+#include "clang/AST/RecordLayout.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/STLExtras.h"
+#include <numeric>
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+namespace {
+
+struct FieldInfo {
+  const FieldDecl *Field;
+  CharUnits Size;
+  CharUnits Align;
+  bool Hot;
+  /// Main file offsets of the whole lines declaring the field.
+  unsigned Begin;
+  unsigned End;
+};
+
+/// Fields of the record an initializer reads through `this`.
+class FieldUseCollector : public RecursiveASTVisitor<FieldUseCollector> {
+public:
+  using Base = RecursiveASTVisitor<FieldUseCollector>;
+
+  explicit FieldUseCollector(const CXXRecordDecl &Record) : Record(Record) {}
+
+  bool TraverseMemberExpr(MemberExpr *E, DataRecursionQueue *Queue = nullptr) {
+    const auto *Field = llvm::dyn_cast<FieldDecl>(E->getMemberDecl());
+    if (Field && llvm::isa<CXXThisExpr>(E->getBase()->IgnoreParenImpCasts())) {
+      // Base class fields are initialized before any of ours.
+      if (Field->getParent() == &Record)
+        Used.push_back(Field);
+      return true;
+    }
+    return Base::TraverseMemberExpr(E, Queue);
+  }
+
+  bool VisitCXXThisExpr(CXXThisExpr *) {
+    EscapesThis = true;
+    return true;
+  }
+
+  llvm::SmallVector<const FieldDecl *, 4> Used;
+  bool EscapesThis = false;
+
+private:
+  const CXXRecordDecl &Record;
+};
+
+/// Whether running \p Init earlier or later than before may be observed.
+bool mayHaveSideEffects(const Expr &Init, const ASTContext &Ctx) {
+  const Expr *E = Init.IgnoreImplicit();
+  if (const auto *Default = llvm::dyn_cast<CXXDefaultArgExpr>(E))
+    E = Default->getExpr()->IgnoreImplicit();
+  // Standard library constructors only touch the object they build.
+  if (const auto *Construct = llvm::dyn_cast<CXXConstructExpr>(E))
+    if (Construct->getConstructor()->getParent()->isInStdNamespace())
+      return llvm::any_of(Construct->arguments(), [&](const Expr *Arg) {
+        return mayHaveSideEffects(*Arg, Ctx);
+      });
+  return E->HasSideEffects(Ctx, /*IncludePossibleEffects=*/true);
+}
+
+/// Whether default-constructing or destroying a \p T member at another point
+/// may be observed.
+bool hasObservableLifetime(QualType T, const ASTContext &Ctx) {
+  const auto *Record = Ctx.getBaseElementType(T)->getAsCXXRecordDecl();
+  if (!Record || !Record->hasDefinition() || Record->isInStdNamespace())
+    return false;
+  if (Record->hasUserProvidedDefaultConstructor())
+    return true;
+  const CXXDestructorDecl *Dtor = Record->getDestructor();
+  return Dtor && Dtor->isUserProvided();
+}
+
+/// The `[[` or `__attribute__` token that opens the attribute specifier
+/// \p A is written in; its own location is the attribute name inside it.
+/// Invalid if no opener precedes it within the declaration.
+SourceLocation getAttributeSpecifierBegin(const Attr &A,
+                                          const ASTContext &Ctx) {
+  const SourceManager &Sm = Ctx.getSourceManager();
+  const LangOptions &Lo = Ctx.getLangOpts();
+  auto Previous = [&](SourceLocation Loc) {
+    return utils::lexer::getPreviousToken(Loc, Sm, Lo);
+  };
+  SourceLocation Loc = A.getLocation();
+  unsigned Depth = 0;
+  while (Loc.isValid() && Loc.isFileID()) {
+    Token Tok = Previous(Loc);
+    if (Tok.isOneOf(tok::unknown, tok::semi, tok::l_brace, tok::r_brace))
+      return {};
+    Loc = Tok.getLocation();
+    if (Tok.isOneOf(tok::r_paren, tok::r_square)) {
+      ++Depth;
+      continue;
+    }
+    if (!Tok.isOneOf(tok::l_paren, tok::l_square))
+      continue;
+    if (Depth > 0) {
+      --Depth;
+      continue;
+    }
+    Token Outer = Previous(Loc);
+    if (Tok.is(tok::l_square) && Outer.is(tok::l_square))
+      return Outer.getLocation();
+    if (Tok.is(tok::l_paren) && Outer.is(tok::l_paren)) {
+      Token Keyword = Previous(Outer.getLocation());
+      if (Keyword.is(tok::kw___attribute))
+        return Keyword.getLocation();
+    }
+  }
+  return {};
+}
+
+/// Finds the whole lines declaring \p Field, its attributes and doc comment
+/// included. Fails if they hold anything else but a trailing `//` comment,
+/// or if a plain comment right above would be left behind.
+bool getFieldLines(const FieldDecl &Field, const ASTContext &Ctx,
+                   unsigned &Begin, unsigned &End) {
+  const SourceManager &Sm = Ctx.getSourceManager();
+  auto Semi = Lexer::findNextToken(Field.getEndLoc(), Sm, Ctx.getLangOpts());
+  if (!Semi || !Semi->is(tok::semi))
+    return false;
+  SourceLocation First = Field.getBeginLoc();
+  auto Extend = [&](SourceLocation Loc) {
+    if (Loc.isValid() && Sm.isBeforeInTranslationUnit(Loc, First))
+      First = Loc;
+  };
+  for (const Attr *A : Field.attrs()) {
+    if (A->isImplicit())
+      continue;
+    // alignas is its own keyword; other attributes sit inside a specifier.
+    if (A->isAlignasAttribute()) {
+      Extend(A->getLocation());
+      continue;
+    }
+    SourceLocation Specifier = getAttributeSpecifierBegin(*A, Ctx);
+    if (Specifier.isInvalid())
+      return false;
+    Extend(Specifier);
+  }
+  if (const RawComment *Comment = Ctx.getRawCommentForDeclNoCache(&Field))
+    Extend(Comment->getBeginLoc());
+  SourceLocation Last = Semi->getLocation();
+  FileID Main = Sm.getMainFileID();
+  if (!First.isFileID() || !Last.isFileID() || Sm.getFileID(First) != Main ||
+      Sm.getFileID(Last) != Main)
+    return false;
+
+  StringRef Buffer = Sm.getBufferData(Main);
+  StringRef Before = Buffer.take_front(Sm.getFileOffset(First));
+  size_t LineBegin = Before.rfind('\n') + 1;
+  if (!Before.drop_front(LineBegin).trim(" \t").empty())
+    return false;
+  if (LineBegin > 0) {
+    StringRef Above = Buffer.take_front(LineBegin - 1);
+    Above = Above.drop_front(Above.rfind('\n') + 1).trim();
+    if (Above.startswith("//") || Above.startswith("/*") ||
+        Above.endswith("*/"))
+      return false;
+  }
+  unsigned AfterSemi = Sm.getFileOffset(Last) + 1;
+  StringRef Rest = Buffer.drop_front(AfterSemi);
+  size_t Eol = Rest.find('\n');
+  StringRef Tail = Rest.take_front(Eol).trim(" \t\r");
+  if (!Tail.empty() && !Tail.startswith("//"))
+    return false;
+  Begin = LineBegin;
+  End = Eol == StringRef::npos ? Buffer.size() : AfterSemi + Eol + 1;
+  return true;
+}
+
+/// Only methods may sit between the first and the last field; a field moved
+/// above a type or static member it names would no longer compile.
+bool hasOnlyMethodsBetweenFields(const CXXRecordDecl &Record,
+                                 unsigned NumFields) {
+  unsigned Seen = 0;
+  for (const Decl *D : Record.decls()) {
+    if (llvm::isa<FieldDecl>(D)) {
+      ++Seen;
+      continue;
+    }
+    if (Seen == 0 || Seen == NumFields || D->isImplicit() ||
+        llvm::isa<AccessSpecDecl, CXXMethodDecl, FunctionTemplateDecl,
+                  FriendDecl>(D))
+      continue;
+    return false;
+  }
+  return true;
+}
+
+/// Constructors defined out of line are not in this analysis, so their
+/// initializers could neither be checked nor rewritten.
+bool hasOnlyInlineConstructors(const CXXRecordDecl &Record) {
+  for (const Decl *D : Record.decls())
+    if (const auto *Template = llvm::dyn_cast<FunctionTemplateDecl>(D))
+      if (llvm::isa<CXXConstructorDecl>(Template->getTemplatedDecl()))
+        return false;
+  return llvm::all_of(Record.ctors(), [](const CXXConstructorDecl *Ctor) {
+    return Ctor->isImplicit() || Ctor->isDeleted() || Ctor->isDefaulted() ||
+           Ctor->isThisDeclarationADefinition();
+  });
+}
+
+/// Lays out the fields in \p Order from \p Offset the way the Itanium ABI
+/// places members that are not bit-fields; returns the end of the last one.
+CharUnits layOut(llvm::ArrayRef<FieldInfo> Fields,
+                 llvm::ArrayRef<unsigned> Order, CharUnits Offset,
+                 llvm::SmallVectorImpl<CharUnits> &Offsets) {
+  Offsets.assign(Fields.size(), CharUnits::Zero());
+  for (unsigned I : Order) {
+    Offset = Offset.alignTo(Fields[I].Align);
+    Offsets[I] = Offset;
+    Offset += Fields[I].Size;
+  }
+  return Offset;
+}
+
+/// Whether initializing the fields by \p Rank computes the same values with
+/// the same observable effects as declaration order does.
+bool canReorder(const CXXRecordDecl &Record, llvm::ArrayRef<FieldInfo> Fields,
+                llvm::ArrayRef<unsigned> Rank,
+                const RecordInitAnalysis &Analysis, const ASTContext &Ctx) {
+  auto ReadsOnlyEarlierFields = [&](unsigned I, const Expr *Init) {
+    FieldUseCollector Uses(Record);
+    Uses.TraverseStmt(const_cast<Expr *>(Init));
+    return !Uses.EscapesThis &&
+           llvm::all_of(Uses.Used, [&](const FieldDecl *Used) {
+             return Used == Fields[I].Field ||
+                    Rank[Used->getFieldIndex()] < Rank[I];
+           });
+  };
+
+  // Fields whose initialization may be observed keep their relative order.
+  bool SeenObservable = false;
+  unsigned LastObservableRank = 0;
+  const auto &InitsByField = Analysis.initsByField();
+  for (unsigned I = 0; I < Fields.size(); ++I) {
+    const FieldDecl *Field = Fields[I].Field;
+    bool Observable = hasObservableLifetime(Field->getType(), Ctx);
+    llvm::SmallVector<const Expr *, 4> Inits;
+    if (const Expr *Default = Field->getInClassInitializer())
+      Inits.push_back(Default);
+    auto It = InitsByField.find(Field);
+    if (It != InitsByField.end())
+      for (const auto *Init : It->second)
+        Inits.push_back(Init->getInit());
+    for (const Expr *Init : Inits) {
+      if (!ReadsOnlyEarlierFields(I, Init))
+        return false;
+      Observable = Observable || mayHaveSideEffects(*Init, Ctx);
+    }
+    if (!Observable)
+      continue;
+    if (SeenObservable && Rank[I] < LastObservableRank)
+      return false;
+    SeenObservable = true;
+    LastObservableRank = Rank[I];
+  }
+
+  for (const auto &Ctor : Analysis.ctors())
+    for (const auto *Init : Ctor.Written)
+      if (!Init->getSourceRange().getBegin().isFileID() ||
+          !Init->getSourceRange().getEnd().isFileID())
+        return false;
+  return true;
+}
+
+} // namespace
+
+ReorderFieldsForPadding::ReorderFieldsForPadding(StringRef Name,
+                                                 ClangTidyContext *Context)
+    : ClangTidyCheck(Name, Context),
+      HotAnnotation(Options.get("HotAnnotation", "mir-hot")) {}
+
+void ReorderFieldsForPadding::storeOptions(
+    ClangTidyOptions::OptionMap &Opts) {
+  Options.store(Opts, "HotAnnotation", HotAnnotation);
+}
+
+void ReorderFieldsForPadding::registerMatchers(MatchFinder *Finder) {
+  Finder->addMatcher(cxxRecordDecl(isDefinition(), isExpansionInMainFile(),
+                                   unless(isImplicit()), unless(isUnion()),
+                                   unless(isLambda()))
+                         .bind("record"),
+                     this);
+}
+
+void ReorderFieldsForPadding::check(const MatchFinder::MatchResult &Result) {
+  const auto *Record = Result.Nodes.getNodeAs<CXXRecordDecl>("record");
+  ASTContext &Ctx = *Result.Context;
+  const SourceManager &Sm = Ctx.getSourceManager();
+  // Aggregate initialization and structured bindings go by field position.
+  if (Record->isInvalidDecl() || Record->isDependentContext() ||
+      Record->isAggregate() ||
+      llvm::isa<ClassTemplateSpecializationDecl>(Record) ||
+      Record->getNumVBases() || Record->hasAttr<PackedAttr>() ||
+      Record->hasAttr<MaxFieldAlignmentAttr>())
+    return;
+
+  llvm::SmallVector<FieldInfo, 16> Fields;
+  for (const FieldDecl *Field : Record->fields()) {
+    if (Field->isBitField() || Field->isAnonymousStructOrUnion() ||
+        Field->hasAttr<NoUniqueAddressAttr>() ||
+        Field->getType()->isReferenceType() ||
+        Field->getType()->isIncompleteArrayType() ||
+        Field->getAccess() != Record->field_begin()->getAccess())
+      return;
+    FieldInfo Info{Field, Ctx.getTypeSizeInChars(Field->getType()),
+                   Ctx.getDeclAlign(Field),
+                   llvm::any_of(Field->specific_attrs<AnnotateAttr>(),
+                                [this](const AnnotateAttr *A) {
+                                  return A->getAnnotation() == HotAnnotation;
+                                }),
+                   0, 0};
+    if (!getFieldLines(*Field, Ctx, Info.Begin, Info.End) ||
+        (!Fields.empty() && Info.Begin < Fields.back().End))
+      return;
+    Fields.push_back(Info);
+  }
+  if (Fields.size() < 2 ||
+      !hasOnlyMethodsBetweenFields(*Record, Fields.size()) ||
+      !hasOnlyInlineConstructors(*Record))
+    return;
+
+  // Model the current layout first; records it does not reproduce use rules
+  // this check does not know.
+  const ASTRecordLayout &Layout = Ctx.getASTRecordLayout(Record);
+  CharUnits Start = Ctx.toCharUnitsFromBits(Layout.getFieldOffset(0));
+  llvm::SmallVector<unsigned, 16> Order(Fields.size());
+  std::iota(Order.begin(), Order.end(), 0);
+  llvm::SmallVector<CharUnits, 16> Offsets;
+  CharUnits Size =
+      layOut(Fields, Order, Start, Offsets).alignTo(Layout.getAlignment());
+  if (Size != Layout.getSize())
+    return;
+  for (unsigned I = 0; I < Fields.size(); ++I)
+    if (Offsets[I] != Ctx.toCharUnitsFromBits(Layout.getFieldOffset(I)))
+      return;
+
+  // Decreasing alignment leaves no gaps between fields whose size is a
+  // multiple of their alignment; hot fields stay in front.
+  llvm::SmallVector<unsigned, 16> NewOrder(Order);
+  llvm::stable_sort(NewOrder, [&Fields](unsigned A, unsigned B) {
+    if (Fields[A].Hot != Fields[B].Hot)
+      return Fields[A].Hot;
+    return Fields[A].Align > Fields[B].Align;
+  });
+  CharUnits NewSize =
+      layOut(Fields, NewOrder, Start, Offsets).alignTo(Layout.getAlignment());
+  if (NewSize >= Size)
+    return;
+  llvm::SmallVector<unsigned, 16> Rank(Fields.size());
+  for (unsigned I = 0; I < NewOrder.size(); ++I)
+    Rank[NewOrder[I]] = I;
+  const auto &Analysis = getRecordInitAnalysis(*Record);
+  if (!canReorder(*Record, Fields, Rank, Analysis, Ctx)) {
+    mir::noteSuppressedFix();
+    return;
+  }
+
+  auto Diag = diag(Record->getLocation(),
+                   "%0 can shrink from %1 to %2 bytes by reordering its fields",
+                   DiagnosticIDs::Warning);
+  Diag << Record << static_cast<unsigned>(Size.getQuantity())
+       << static_cast<unsigned>(NewSize.getQuantity());
+  // Each field's lines take the place of the lines of the field that was
+  // declared at its new position.
+  FileID Main = Sm.getMainFileID();
+  StringRef Buffer = Sm.getBufferData(Main);
+  unsigned NumFixes = 0;
+  for (unsigned I = 0; I < Fields.size(); ++I) {
+    if (NewOrder[I] == I)
+      continue;
+    ++NumFixes;
+    const FieldInfo &Slot = Fields[I];
+    const FieldInfo &Moved = Fields[NewOrder[I]];
+    SourceLocation Begin = Sm.getComposedLoc(Main, Slot.Begin);
+    Diag << FixItHint::CreateReplacement(
+        CharSourceRange::getCharRange(
+            Begin, Begin.getLocWithOffset(Slot.End - Slot.Begin)),
+        Buffer.slice(Moved.Begin, Moved.End));
+  }
+  for (const auto &Ctor : Analysis.ctors()) {
+    // Base and delegating initializers keep leading the list.
+    llvm::SmallVector<const CXXCtorInitializer *> Ordered;
+    llvm::SmallVector<const CXXCtorInitializer *> Members;
+    for (const auto *Init : Ctor.Written)
+      (Init->getMember() ? Members : Ordered).push_back(Init);
+    llvm::stable_sort(Members, [&Rank](const auto *A, const auto *B) {
+      return Rank[A->getMember()->getFieldIndex()] <
+             Rank[B->getMember()->getFieldIndex()];
+    });
+    Ordered.append(Members.begin(), Members.end());
+    if (Ordered != Ctor.Written) {
+      Diag << createInitializerReorderFix(Sm, Saver, Ctor.Written, Ordered);
+      ++NumFixes;
+    }
+  }
+  mir::noteFixIts(NumFixes);
+}
+
+void ReorderFieldsForPadding::onEndOfTranslationUnit() {
+  resetRecordInitAnalyses();
+}
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
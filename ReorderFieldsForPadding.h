@@ -0,0 +1,50 @@
+//===--- ReorderFieldsForPadding.h - clang-tidy -----------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_REORDERFIELDSFORPADDING_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_REORDERFIELDSFORPADDING_H
+
+#include "clang-tidy/ClangTidyCheck.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
+#include <string>
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+/// Finds classes whose field order wastes padding and moves the field
+/// declarations into the order with the smallest layout: fields annotated
+/// with `[[clang::annotate("<HotAnnotation>")]]` first, then the rest, each
+/// group by decreasing alignment. Every constructor's initializer list is
+/// rewritten to the new order in the same fix.
+///
+/// Records are left alone when the reorder could change behaviour or the
+/// fields cannot be moved as whole lines: an initializer that may have side
+/// effects, uses `this` other than to read a field, or reads a field the new
+/// order would initialize later; bit-fields; mixed access; constructors
+/// defined outside the class.
+class ReorderFieldsForPadding : public ClangTidyCheck {
+public:
+  ReorderFieldsForPadding(StringRef Name, ClangTidyContext *Context);
+  void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void onEndOfTranslationUnit() override;
+
+private:
+  const std::string HotAnnotation;
+  llvm::BumpPtrAllocator Arena;
+  llvm::StringSaver Saver{Arena};
+};
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_REORDERFIELDSFORPADDING_H
@@ -0,0 +1,123 @@
+//===--- ResultCache.cpp - mir-migrate ------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "ResultCache.h"
+
+#include "clang/Tooling/DiagnosticsYaml.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+ResultCache::ResultCache(std::string Dir, std::string BuildId)
+    : Dir(std::move(Dir)), BuildId(std::move(BuildId)) {}
+
+std::string ResultCache::computeKey(
+    StringRef PreprocessedDigest,
+    const std::vector<tooling::CompileCommand> &Commands,
+    StringRef CheckOptions, bool ApplyAnyFix) const {
+  llvm::MD5 Hash;
+  auto Field = [&Hash](StringRef Value) {
+    Hash.update(Value);
+    Hash.update(StringRef("\0", 1));
+  };
+  Field(BuildId);
+  Field(PreprocessedDigest);
+  for (const auto &Command : Commands) {
+    Field(Command.Directory);
+    for (const auto &Arg : Command.CommandLine)
+      Field(Arg);
+  }
+  Field(CheckOptions);
+  Field(ApplyAnyFix ? "fixes-from-notes" : "fixes");
+  llvm::MD5::MD5Result Digest;
+  Hash.final(Digest);
+  return Digest.digest().str().str();
+}
+
+std::string ResultCache::getEntryPath(StringRef Key) const {
+  llvm::SmallString<256> Path(Dir);
+  llvm::sys::path::append(Path, Key.take_front(2), Key + ".yaml");
+  return Path.str().str();
+}
+
+bool ResultCache::lookup(StringRef Key, ClangTidyContext &Context,
+                         std::vector<ClangTidyError> &Errors) {
+  auto Buffer = llvm::MemoryBuffer::getFile(getEntryPath(Key));
+  if (!Buffer) {
+    ++Misses;
+    return false;
+  }
+  tooling::TranslationUnitDiagnostics Entry;
+  llvm::yaml::Input YIn((*Buffer)->getBuffer());
+  YIn >> Entry;
+  if (YIn.error()) {
+    ++Misses;
+    return false;
+  }
+
+  Errors.clear();
+  for (auto &Diag : Entry.Diagnostics) {
+    bool IsWarningAsError = Diag.DiagLevel == tooling::Diagnostic::Warning &&
+                            Context.treatAsError(Diag.DiagnosticName);
+    ClangTidyError Error(Diag.DiagnosticName, Diag.DiagLevel,
+                         Diag.BuildDirectory, IsWarningAsError);
+    Error.Message = std::move(Diag.Message);
+    Error.Notes = std::move(Diag.Notes);
+    Errors.push_back(std::move(Error));
+  }
+  ++Hits;
+  return true;
+}
+
+void ResultCache::store(StringRef Key, StringRef MainFile,
+                        const std::vector<ClangTidyError> &Errors) {
+  std::string Path = getEntryPath(Key);
+  if (llvm::sys::fs::create_directories(llvm::sys::path::parent_path(Path)))
+    return;
+
+  tooling::TranslationUnitDiagnostics Entry;
+  Entry.MainSourceFile = MainFile.str();
+  Entry.Diagnostics.insert(Entry.Diagnostics.end(), Errors.begin(),
+                           Errors.end());
+
+  int FD;
+  llvm::SmallString<256> TmpPath;
+  if (llvm::sys::fs::createUniqueFile(Path + ".tmp-%%%%%%%%", FD, TmpPath))
+    return;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    llvm::yaml::Output YAML(OS);
+    YAML << Entry;
+  }
+  if (llvm::sys::fs::rename(TmpPath, Path))
+    llvm::sys::fs::remove(TmpPath);
+}
+
+std::string ResultCache::getExecutableBuildId(const char *Argv0,
+                                              void *MainAddr) {
+  std::string Exe = llvm::sys::fs::getMainExecutable(Argv0, MainAddr);
+  auto Buffer = llvm::MemoryBuffer::getFile(Exe);
+  if (!Buffer)
+    return Exe;
+  llvm::MD5 Hash;
+  Hash.update((*Buffer)->getBuffer());
+  llvm::MD5::MD5Result Digest;
+  Hash.final(Digest);
+  return Digest.digest().str().str();
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
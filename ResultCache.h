@@ -0,0 +1,67 @@
+//===--- ResultCache.h - mir-migrate ----------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_RESULTCACHE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_RESULTCACHE_H
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+/// Content-addressed on-disk store of per-TU clang-tidy results.
+///
+/// Entries live in <Dir>/<first two hex digits>/<key>.yaml in the
+/// clang-apply-replacements diagnostics format and are written through a
+/// temporary file plus rename, so concurrent workers and processes can share
+/// one directory.
+class ResultCache {
+public:
+  /// \p BuildId identifies the binary that produced the results; entries from
+  /// a different build are never replayed.
+  ResultCache(std::string Dir, std::string BuildId);
+
+  /// Combines everything that can change a TU's results into one key.
+  std::string
+  computeKey(StringRef PreprocessedDigest,
+             const std::vector<tooling::CompileCommand> &Commands,
+             StringRef CheckOptions, bool ApplyAnyFix) const;
+
+  /// Loads the entry for \p Key. \p Context must have the TU set as its
+  /// current file; it decides which warnings are treated as errors.
+  bool lookup(StringRef Key, ClangTidyContext &Context,
+              std::vector<ClangTidyError> &Errors);
+
+  void store(StringRef Key, StringRef MainFile,
+             const std::vector<ClangTidyError> &Errors);
+
+  unsigned getHits() const { return Hits; }
+  unsigned getMisses() const { return Misses; }
+
+  /// MD5 of the running executable, suitable as a build ID.
+  static std::string getExecutableBuildId(const char *Argv0, void *MainAddr);
+
+private:
+  std::string getEntryPath(StringRef Key) const;
+
+  std::string Dir;
+  std::string BuildId;
+  std::atomic<unsigned> Hits{0};
+  std::atomic<unsigned> Misses{0};
+};
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_RESULTCACHE_H
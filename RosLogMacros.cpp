@@ -0,0 +1,240 @@
+//===--- RosLogMacros.cpp - clang-tidy ------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "RosLogMacros.h"
+
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/MacroArgs.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringSwitch.h"
+#include <algorithm>
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+bool parseRosLogMacro(StringRef MacroName, RosLogFamily Family,
+                      RosLogMacro &Result) {
+  if (!MacroName.consume_front("ROS_"))
+    return false;
+  StringRef Level = llvm::StringSwitch<StringRef>(
+                        MacroName.take_until([](char C) { return C == '_'; }))
+                        .Case("DEBUG", "DEBUG")
+                        .Case("INFO", "INFO")
+                        .Case("WARN", "WARN")
+                        .Case("ERROR", "ERROR")
+                        .Case("FATAL", "FATAL")
+                        .Default("");
+  if (Level.empty())
+    return false;
+  MacroName = MacroName.drop_front(Level.size());
+  if (Family == RosLogFamily::Stream && !MacroName.consume_front("_STREAM"))
+    return false;
+  unsigned NumLeadingArgs = llvm::StringSwitch<unsigned>(MacroName)
+                                .Case("", 0)
+                                .Case("_NAMED", 1)
+                                .Case("_COND", 1)
+                                .Case("_COND_NAMED", 2)
+                                .Case("_ONCE", 0)
+                                .Case("_ONCE_NAMED", 1)
+                                .Case("_THROTTLE", 1)
+                                .Case("_THROTTLE_NAMED", 2)
+                                .Case("_DELAYED_THROTTLE", 1)
+                                .Case("_DELAYED_THROTTLE_NAMED", 2)
+                                .Default(~0U);
+  if (NumLeadingArgs == ~0U)
+    return false;
+  Result = {Level, MacroName, NumLeadingArgs};
+  return true;
+}
+
+const Expr *splitStreamChain(const Expr &Chain,
+                             llvm::SmallVectorImpl<const Expr *> &Operands) {
+  size_t First = Operands.size();
+  const Expr *Lhs = &Chain;
+  while (const auto *Op = llvm::dyn_cast<CXXOperatorCallExpr>(Lhs)) {
+    if (Op->getOperator() != OO_LessLess)
+      break;
+    Operands.push_back(Op->getArg(1));
+    Lhs = Op->getArg(0);
+  }
+  if (Operands.size() == First)
+    return nullptr;
+  std::reverse(Operands.begin() + First, Operands.end());
+  return Lhs->IgnoreParenImpCasts();
+}
+
+namespace {
+
+/// rosconsole streams the arguments of every stream macro into a local of
+/// this name.
+constexpr llvm::StringLiteral RosconsoleStream =
+    "__rosconsole_print_stream_at_location_with_filter__ss__";
+
+bool isRosconsoleStreamChain(const CXXOperatorCallExpr &Oper) {
+  llvm::SmallVector<const Expr *, 16> Operands;
+  const auto *Ref =
+      llvm::dyn_cast_or_null<DeclRefExpr>(splitStreamChain(Oper, Operands));
+  if (!Ref)
+    return false;
+  const IdentifierInfo *Name = Ref->getDecl()->getIdentifier();
+  return Name && Name->getName() == RosconsoleStream;
+}
+
+} // namespace
+
+const CXXOperatorCallExpr *findRosconsoleStreamChain(const Stmt &S) {
+  // The leading arguments of the COND and THROTTLE variants expand into the
+  // same block, so the chain is identified by the stream it writes to.
+  for (const Stmt *Child : S.children()) {
+    if (!Child)
+      continue;
+    if (const auto *Oper = llvm::dyn_cast<CXXOperatorCallExpr>(Child))
+      if (Oper->getOperator() == OO_LessLess && isRosconsoleStreamChain(*Oper))
+        return Oper;
+    if (const auto *Found = findRosconsoleStreamChain(*Child))
+      return Found;
+  }
+  return nullptr;
+}
+
+namespace {
+
+class LogMacroCollector : public PPCallbacks {
+public:
+  LogMacroCollector(const SourceManager &Sm, const LangOptions &LangOpts,
+                    RosLogFamily Family,
+                    llvm::SmallVectorImpl<LogExpansion> &Expansions)
+      : Sm(Sm), LangOpts(LangOpts), Family(Family), Expansions(Expansions) {}
+
+  void MacroExpands(const Token &MacroNameTok, const MacroDefinition &MD,
+                    SourceRange Range, const MacroArgs *Args) override {
+    const IdentifierInfo *II = MacroNameTok.getIdentifierInfo();
+    if (!II || !Args)
+      return;
+    RosLogMacro Logger;
+    // The format string or stream expression is always the last argument;
+    // for the printf family it is __VA_ARGS__ and carries the values too.
+    if (!parseRosLogMacro(II->getName(), Family, Logger) ||
+        !Range.getBegin().isFileID() || !Sm.isInMainFile(Range.getBegin()) ||
+        Args->getNumMacroArguments() != Logger.NumLeadingArgs + 1)
+      return;
+    LogExpansion Expansion{Sm.getFileOffset(Range.getBegin()),
+                           Sm.getFileOffset(Range.getEnd()), Logger.Level,
+                           Logger.Variant};
+    for (unsigned I = 0; I < Logger.NumLeadingArgs; ++I) {
+      StringRef Arg = getArgumentText(*Args, I);
+      if (Arg.empty())
+        return;
+      Expansion.LeadingArgs.push_back(Arg);
+    }
+    Expansions.push_back(std::move(Expansion));
+  }
+
+private:
+  StringRef getArgumentText(const MacroArgs &Args, unsigned I) const {
+    const Token *First = Args.getUnexpArgument(I);
+    unsigned Length = MacroArgs::getArgLength(First);
+    if (!Length)
+      return {};
+    SourceLocation Begin = First->getLocation();
+    SourceLocation End = First[Length - 1].getLocation();
+    if (!Begin.isFileID() || !End.isFileID())
+      return {};
+    return Lexer::getSourceText(CharSourceRange::getTokenRange(Begin, End), Sm,
+                                LangOpts);
+  }
+
+  const SourceManager &Sm;
+  const LangOptions &LangOpts;
+  RosLogFamily Family;
+  llvm::SmallVectorImpl<LogExpansion> &Expansions;
+};
+
+class LogStatementFinder : public RecursiveASTVisitor<LogStatementFinder> {
+public:
+  using Base = RecursiveASTVisitor<LogStatementFinder>;
+
+  LogStatementFinder(const SourceManager &Sm,
+                     llvm::MutableArrayRef<LogExpansion> Expansions,
+                     LogStatementCallback OnLogStatement)
+      : Sm(Sm), Expansions(Expansions), OnLogStatement(OnLogStatement) {}
+
+  bool shouldVisitTemplateInstantiations() const { return true; }
+
+  bool TraverseDecl(Decl *D) {
+    if (D && !llvm::isa<TranslationUnitDecl>(D) &&
+        !overlapsExpansion(D->getSourceRange()))
+      return true;
+    return Base::TraverseDecl(D);
+  }
+
+  bool TraverseStmt(Stmt *S, DataRecursionQueue *Queue = nullptr) {
+    if (S && !overlapsExpansion(S->getSourceRange()))
+      return true;
+    return Base::TraverseStmt(S, Queue);
+  }
+
+  bool VisitCompoundStmt(CompoundStmt *S) {
+    if (!S->getBeginLoc().isMacroID())
+      return true;
+    auto [Fid, Offset] = Sm.getDecomposedExpansionLoc(S->getBeginLoc());
+    if (Fid != Sm.getMainFileID())
+      return true;
+    auto *It = llvm::partition_point(
+        Expansions, [Offset = Offset](const auto &E) { return E.Begin < Offset; });
+    if (It == Expansions.end() || It->Begin != Offset || It->Handled)
+      return true;
+    if (OnLogStatement(*S, *It))
+      It->Handled = true;
+    return true;
+  }
+
+private:
+  bool overlapsExpansion(SourceRange Range) const {
+    if (Range.isInvalid())
+      return false;
+    auto [BeginFid, Begin] = Sm.getDecomposedExpansionLoc(Range.getBegin());
+    auto [EndFid, End] = Sm.getDecomposedExpansionLoc(Range.getEnd());
+    FileID Main = Sm.getMainFileID();
+    if (BeginFid != Main && EndFid != Main)
+      return false;
+    // A range that starts or ends outside the main file (e.g. a namespace
+    // reopened around an #include) cannot be bounded by offsets.
+    if (BeginFid != Main || EndFid != Main)
+      return true;
+    const auto *It = llvm::partition_point(
+        Expansions, [Begin = Begin](const auto &E) { return E.End < Begin; });
+    return It != Expansions.end() && It->Begin <= End;
+  }
+
+  const SourceManager &Sm;
+  llvm::MutableArrayRef<LogExpansion> Expansions;
+  LogStatementCallback OnLogStatement;
+};
+
+} // namespace
+
+std::unique_ptr<PPCallbacks>
+createLogMacroCollector(const SourceManager &Sm, const LangOptions &LangOpts,
+                        RosLogFamily Family,
+                        llvm::SmallVectorImpl<LogExpansion> &Expansions) {
+  return std::make_unique<LogMacroCollector>(Sm, LangOpts, Family, Expansions);
+}
+
+void findLogStatements(const SourceManager &Sm, TranslationUnitDecl &TU,
+                       llvm::MutableArrayRef<LogExpansion> Expansions,
+                       LogStatementCallback OnLogStatement) {
+  LogStatementFinder Finder(Sm, Expansions, OnLogStatement);
+  Finder.TraverseDecl(&TU);
+}
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
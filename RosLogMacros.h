@@ -0,0 +1,90 @@
+//===--- RosLogMacros.h - clang-tidy ----------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_ROSLOGMACROS_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_ROSLOGMACROS_H
+
+#include "clang/AST/Decl.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/Stmt.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include <memory>
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+/// The two families of rosconsole loggers: ROS_<LEVEL>[_<VARIANT>](fmt, ...)
+/// and ROS_<LEVEL>_STREAM[_<VARIANT>](stream-expr).
+enum class RosLogFamily { Printf, Stream };
+
+/// A ROS logging macro. Each has a ROSFMT_<LEVEL><Variant> twin taking the
+/// same leading arguments (condition, throttle period, logger name) before
+/// the format string.
+struct RosLogMacro {
+  StringRef Level;
+  /// The macro name's variant suffix, e.g. "_THROTTLE_NAMED".
+  StringRef Variant;
+  unsigned NumLeadingArgs;
+};
+
+bool parseRosLogMacro(StringRef MacroName, RosLogFamily Family,
+                      RosLogMacro &Result);
+
+/// A ROS logging macro invocation written in the main file, recorded while
+/// preprocessing. Offsets are into the main file buffer.
+struct LogExpansion {
+  unsigned Begin;
+  unsigned End;
+  StringRef Level;
+  StringRef Variant;
+  /// Source text of the arguments before the format string or stream
+  /// expression.
+  llvm::SmallVector<StringRef, 2> LeadingArgs = {};
+  bool Handled = false;
+};
+
+/// Records every \p Family logger expanded directly in the main file into
+/// \p Expansions, in source order.
+std::unique_ptr<PPCallbacks>
+createLogMacroCollector(const SourceManager &Sm, const LangOptions &LangOpts,
+                        RosLogFamily Family,
+                        llvm::SmallVectorImpl<LogExpansion> &Expansions);
+
+/// Called with the block a recorded expansion expands to; returns true if the
+/// log statement was recognized, which marks the expansion handled.
+using LogStatementCallback =
+    llvm::function_ref<bool(const CompoundStmt &, LogExpansion &)>;
+
+/// Walks only the declarations and statements of \p TU whose main-file range
+/// overlaps one of \p Expansions, so the cost scales with the number of log
+/// calls rather than with the size of the AST. Checks using it only match
+/// the translation unit itself.
+void findLogStatements(const SourceManager &Sm, TranslationUnitDecl &TU,
+                       llvm::MutableArrayRef<LogExpansion> Expansions,
+                       LogStatementCallback OnLogStatement);
+
+/// Splits `S << a << b`, which is `(S << a) << b`, into S and {a, b} in
+/// source order. Returns null if \p Chain is not a call to `<<`.
+const Expr *splitStreamChain(const Expr &Chain,
+                             llvm::SmallVectorImpl<const Expr *> &Operands);
+
+/// Finds the `<<` chain writing to rosconsole's local stream in the
+/// expansion of a ROS_<LEVEL>_STREAM* macro.
+const CXXOperatorCallExpr *findRosconsoleStreamChain(const Stmt &S);
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_ROSLOGMACROS_H
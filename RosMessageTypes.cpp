@@ -0,0 +1,57 @@
+//===--- RosMessageTypes.cpp - clang-tidy ---------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "RosMessageTypes.h"
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+namespace {
+
+unsigned countHeapMembers(const CXXRecordDecl &Record, const ASTContext &Ctx,
+                          unsigned Depth) {
+  if (Depth > 8)
+    return 0;
+  unsigned Count = 0;
+  for (const FieldDecl *Field : Record.fields()) {
+    const auto *Member =
+        Ctx.getBaseElementType(Field->getType())->getAsCXXRecordDecl();
+    if (!Member || !Member->hasDefinition())
+      continue;
+    if (Member->isInStdNamespace()) {
+      if (Member->getIdentifier() && (Member->getName() == "vector" ||
+                                      Member->getName() == "basic_string"))
+        ++Count;
+      continue;
+    }
+    Count += countHeapMembers(*Member, Ctx, Depth + 1);
+  }
+  return Count;
+}
+
+} // namespace
+
+const CXXRecordDecl *getRosMessage(QualType T) {
+  const auto *Record = T->getAsCXXRecordDecl();
+  if (!Record || !Record->hasDefinition())
+    return nullptr;
+  for (const Decl *D : Record->decls())
+    if (const auto *Alias = llvm::dyn_cast<TypedefNameDecl>(D))
+      if (Alias->getIdentifier() && Alias->getName() == "ConstPtr")
+        return Record;
+  return nullptr;
+}
+
+unsigned countHeapMembers(const CXXRecordDecl &Message,
+                          const ASTContext &Ctx) {
+  return countHeapMembers(Message, Ctx, 0);
+}
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,31 @@
+//===--- RosMessageTypes.h - clang-tidy -------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_ROSMESSAGETYPES_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_ROSMESSAGETYPES_H
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+/// Generated ROS messages, `pkg::Name_<Allocator>`, are the records that
+/// declare a ConstPtr typedef. Returns the message record \p T names, if any.
+const CXXRecordDecl *getRosMessage(QualType T);
+
+/// Counts the strings and vectors a copy of \p Message duplicates on the
+/// heap, through nested messages and arrays.
+unsigned countHeapMembers(const CXXRecordDecl &Message, const ASTContext &Ctx);
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_ROSMESSAGETYPES_H
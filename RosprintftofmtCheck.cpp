@@ -0,0 +1,377 @@
+//===--- RosprintftofmtCheck.cpp - clang-tidy -----------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "RosprintftofmtCheck.h"
+#include "CheckMetrics.h"
+#include "FormatStringBuilder.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/FormatString.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/SmallString.h"
+#include "utils.hpp"
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+namespace {
+
+using analyze_format_string::ConversionSpecifier;
+using analyze_format_string::LengthModifier;
+using analyze_format_string::OptionalAmount;
+using analyze_printf::PrintfSpecifier;
+
+/// rosconsole's printf path ends in a variadic call whose last named
+/// parameter is the format string. The leading arguments of the COND and
+/// THROTTLE variants expand into the same block, but never into such a call
+/// with a literal format.
+const CallExpr *findPrintCall(const Stmt &S) {
+  for (const Stmt *Child : S.children()) {
+    if (!Child)
+      continue;
+    if (const auto *Call = llvm::dyn_cast<CallExpr>(Child)) {
+      const FunctionDecl *Callee = Call->getDirectCallee();
+      if (Callee && Callee->isVariadic() && Callee->getNumParams() > 0 &&
+          Call->getNumArgs() >= Callee->getNumParams() &&
+          llvm::isa<StringLiteral>(
+              Call->getArg(Callee->getNumParams() - 1)->IgnoreParenImpCasts()))
+        return Call;
+    }
+    if (const auto *Found = findPrintCall(*Child))
+      return Found;
+  }
+  return nullptr;
+}
+
+bool isCharOrBool(QualType T) {
+  return T->isAnyCharacterType() || T->isBooleanType();
+}
+
+bool isNarrowString(QualType T) {
+  if (const auto *Array = T->getAsArrayTypeUnsafe())
+    return Array->getElementType()->isCharType();
+  return T->isPointerType() && T->getPointeeType()->isCharType();
+}
+
+/// `S.c_str()` on a std::string: S.
+const Expr *getCStrObject(const Expr &E) {
+  const auto *Call = llvm::dyn_cast<CXXMemberCallExpr>(E.IgnoreParenImpCasts());
+  if (!Call)
+    return nullptr;
+  const auto *Member =
+      llvm::dyn_cast<MemberExpr>(Call->getCallee()->IgnoreParens());
+  const CXXMethodDecl *Method = Call->getMethodDecl();
+  if (!Member || Member->isArrow() || !Method || !Method->getIdentifier() ||
+      !Method->getIdentifier()->isStr("c_str"))
+    return nullptr;
+  const CXXRecordDecl *Record = Method->getParent();
+  if (!Record->isInStdNamespace() || !Record->getIdentifier() ||
+      !Record->getIdentifier()->isStr("basic_string"))
+    return nullptr;
+  return Call->getImplicitObjectArgument();
+}
+
+/// `std::to_string(X)` of an integer: X. The floating-point overloads print
+/// with "%f", which fmt's default presentation does not reproduce.
+const Expr *getToStringInteger(const Expr &E) {
+  const auto *Call = llvm::dyn_cast<CallExpr>(E.IgnoreImplicit());
+  if (!Call || Call->getNumArgs() != 1)
+    return nullptr;
+  const FunctionDecl *Callee = Call->getDirectCallee();
+  if (!Callee || !Callee->isInStdNamespace() || !Callee->getIdentifier() ||
+      !Callee->getIdentifier()->isStr("to_string"))
+    return nullptr;
+  QualType T = Call->getArg(0)->IgnoreImpCasts()->getType();
+  if (!T->isIntegerType() || T->isEnumeralType())
+    return nullptr;
+  return Call->getArg(0);
+}
+
+bool isSpecified(const OptionalAmount &Amount) {
+  return Amount.getHowSpecified() != OptionalAmount::NotSpecified;
+}
+
+/// `*` takes the amount from the argument list, which has no fmt spelling
+/// that keeps the arguments in order.
+bool isConstantOrUnspecified(const OptionalAmount &Amount) {
+  return Amount.getHowSpecified() == OptionalAmount::Constant ||
+         Amount.getHowSpecified() == OptionalAmount::NotSpecified;
+}
+
+/// Translates one printf format string into FormatStringBuilder calls.
+/// Conversions map to placeholders one to one, so anything that would make
+/// fmt print different text stops the translation.
+class PrintfConverter : public analyze_format_string::FormatStringHandler {
+public:
+  PrintfConverter(ASTContext &Ctx, llvm::ArrayRef<const Expr *> Args,
+                  FormatStringBuilder &FSB)
+      : Ctx(Ctx), Args(Args), FSB(FSB) {}
+
+  bool convert(StringRef Format) {
+    Pos = Format.begin();
+    if (analyze_format_string::ParsePrintfString(
+            *this, Format.begin(), Format.end(), Ctx.getLangOpts(),
+            Ctx.getTargetInfo(), /*isFreeBSDKPrintf=*/false) ||
+        Failed || ArgIndex != Args.size())
+      return false;
+    FSB.addText(StringRef(Pos, Format.end() - Pos));
+    return true;
+  }
+
+  bool HandlePrintfSpecifier(const PrintfSpecifier &FS,
+                             const char *StartSpecifier, unsigned SpecifierLen,
+                             const TargetInfo &Target) override {
+    FSB.addText(StringRef(Pos, StartSpecifier - Pos));
+    Pos = StartSpecifier + SpecifierLen;
+    if (!addConversion(FS)) {
+      Failed = true;
+      return false;
+    }
+    return true;
+  }
+
+  bool HandleInvalidPrintfConversionSpecifier(const PrintfSpecifier &FS,
+                                              const char *StartSpecifier,
+                                              unsigned SpecifierLen) override {
+    Failed = true;
+    return false;
+  }
+  void HandleIncompleteSpecifier(const char *StartSpecifier,
+                                 unsigned SpecifierLen) override {
+    Failed = true;
+  }
+  void HandleNullChar(const char *NullCharacter) override { Failed = true; }
+  void HandlePosition(const char *StartPos, unsigned PosLen) override {
+    Failed = true;
+  }
+  void HandleZeroPosition(const char *StartPos, unsigned PosLen) override {
+    Failed = true;
+  }
+
+private:
+  bool addConversion(const PrintfSpecifier &FS);
+  bool printsSameInteger(const Expr &Arg, QualType Written, bool Signed,
+                         bool Narrowed) const;
+
+  ASTContext &Ctx;
+  llvm::ArrayRef<const Expr *> Args;
+  FormatStringBuilder &FSB;
+  const char *Pos = nullptr;
+  unsigned ArgIndex = 0;
+  bool Failed = false;
+};
+
+/// printf reads the promoted argument with the conversion's signedness (after
+/// truncating it for `hh` and `h`) while fmt prints the argument's value, so
+/// they only agree where the sign bit cannot be read differently.
+bool PrintfConverter::printsSameInteger(const Expr &Arg, QualType Written,
+                                        bool Signed, bool Narrowed) const {
+  if (!Narrowed && Written->isUnsignedIntegerType() &&
+      Written->isPromotableIntegerType())
+    return true;
+  if (Written->isSignedIntegerType() == Signed)
+    return true;
+  Expr::EvalResult Value;
+  return Arg.EvaluateAsInt(Value, Ctx) && Value.Val.getInt().isNonNegative();
+}
+
+bool PrintfConverter::addConversion(const PrintfSpecifier &FS) {
+  ConversionSpecifier::Kind Kind = FS.getConversionSpecifier().getKind();
+  if (Kind == ConversionSpecifier::PercentArg) {
+    FSB.addText("%");
+    return true;
+  }
+  const OptionalAmount &Width = FS.getFieldWidth();
+  const OptionalAmount &Precision = FS.getPrecision();
+  if (FS.usesPositionalArg() || FS.hasThousandsGrouping() ||
+      !isConstantOrUnspecified(Width) ||
+      !isConstantOrUnspecified(Precision) ||
+      ArgIndex == Args.size())
+    return false;
+  const Expr *Arg = Args[ArgIndex++];
+  const Expr *Value = Arg;
+  QualType Written = Arg->IgnoreImpCasts()->getType();
+  LengthModifier::Kind Length = FS.getLengthModifier().getKind();
+
+  bool Numeric = true, Signed = false;
+  char Type = 0;
+  switch (Kind) {
+  case ConversionSpecifier::dArg:
+  case ConversionSpecifier::iArg:
+    Signed = true;
+    LLVM_FALLTHROUGH;
+  case ConversionSpecifier::uArg:
+  case ConversionSpecifier::oArg:
+  case ConversionSpecifier::xArg:
+  case ConversionSpecifier::XArg: {
+    bool Narrowed = Length == LengthModifier::AsChar ||
+                    Length == LengthModifier::AsShort;
+    if (!Written->isIntegerType() || Written->isEnumeralType() ||
+        isSpecified(Precision) || FS.hasAlternativeForm() ||
+        (Length == LengthModifier::AsChar &&
+         Ctx.getTypeSize(Written) > Ctx.getCharWidth()) ||
+        (Length == LengthModifier::AsShort &&
+         Ctx.getTypeSize(Written) > Ctx.getTypeSize(Ctx.ShortTy)) ||
+        !printsSameInteger(*Arg, Written, Signed, Narrowed))
+      return false;
+    Type = Kind == ConversionSpecifier::oArg   ? 'o'
+           : Kind == ConversionSpecifier::xArg ? 'x'
+           : Kind == ConversionSpecifier::XArg ? 'X'
+           : isCharOrBool(Written)             ? 'd'
+                                               : 0;
+    break;
+  }
+  case ConversionSpecifier::fArg:
+  case ConversionSpecifier::FArg:
+  case ConversionSpecifier::eArg:
+  case ConversionSpecifier::EArg:
+  case ConversionSpecifier::gArg:
+  case ConversionSpecifier::GArg:
+  case ConversionSpecifier::aArg:
+  case ConversionSpecifier::AArg:
+    Signed = true;
+    if (!Written->isRealFloatingType() || FS.hasAlternativeForm())
+      return false;
+    Type = *FS.getConversionSpecifier().getStart();
+    break;
+  case ConversionSpecifier::cArg:
+    Numeric = false;
+    if (!Written->isIntegerType() || Written->isEnumeralType() ||
+        Length != LengthModifier::None || isSpecified(Precision))
+      return false;
+    Type = 'c';
+    break;
+  case ConversionSpecifier::sArg: {
+    Numeric = false;
+    if (Length != LengthModifier::None)
+      return false;
+    const auto *Lit = llvm::dyn_cast<StringLiteral>(Arg->IgnoreParenImpCasts());
+    if (Lit && Lit->getCharByteWidth() == 1 && !isSpecified(Width) &&
+        !isSpecified(Precision) && !Lit->getString().contains('\0')) {
+      FSB.addText(Lit->getString());
+      return true;
+    }
+    if (const Expr *String = getCStrObject(*Arg)) {
+      Value = String;
+      const Expr *Integer = getToStringInteger(*String);
+      if (Integer && !isSpecified(Precision)) {
+        Value = Integer;
+        if (isCharOrBool(Integer->IgnoreImpCasts()->getType()))
+          Type = 'd';
+      }
+    } else if (!isNarrowString(Written)) {
+      return false;
+    }
+    break;
+  }
+  default:
+    // %p, %n and everything outside C99 printf.
+    return false;
+  }
+  if (!Numeric &&
+      (FS.hasLeadingZeros() || FS.hasPlusPrefix() || FS.hasSpacePrefix() ||
+       FS.hasAlternativeForm()))
+    return false;
+  if (getExprAsString(Ctx.getSourceManager(), *Value).empty())
+    return false;
+
+  llvm::SmallString<16> Spec;
+  // fmt left-aligns strings and characters by default, printf right-aligns
+  // everything.
+  if (FS.isLeftJustified())
+    Spec += '<';
+  else if (!Numeric && isSpecified(Width))
+    Spec += '>';
+  // printf ignores the sign flags for unsigned conversions.
+  if (Signed && FS.hasPlusPrefix())
+    Spec += '+';
+  else if (Signed && FS.hasSpacePrefix())
+    Spec += ' ';
+  if (FS.hasLeadingZeros() && !FS.isLeftJustified() && isSpecified(Width))
+    Spec += '0';
+  if (isSpecified(Width))
+    Spec += std::to_string(Width.getConstantAmount());
+  if (isSpecified(Precision)) {
+    Spec += '.';
+    Spec += std::to_string(Precision.getConstantAmount());
+  }
+  if (Type)
+    Spec += Type;
+  FSB.addFormatExpr(*Value, Spec);
+  return true;
+}
+
+}  // namespace
+
+void RosprintftofmtCheck::registerPPCallbacks(
+    const SourceManager &SM, Preprocessor *PP,
+    Preprocessor *ModuleExpanderPP) {
+  Expansions.clear();
+  PP->addPPCallbacks(createLogMacroCollector(SM, PP->getLangOpts(),
+                                             RosLogFamily::Printf, Expansions));
+}
+
+void RosprintftofmtCheck::registerMatchers(MatchFinder *Finder) {
+  Finder->addMatcher(translationUnitDecl().bind("tu"), this);
+}
+
+void RosprintftofmtCheck::check(const MatchFinder::MatchResult &Result) {
+  const auto *TU = Result.Nodes.getNodeAs<TranslationUnitDecl>("tu");
+  if (!TU || Expansions.empty()) {
+    return;
+  }
+  ASTContext &Ctx = *Result.Context;
+  auto OnLogStatement = [this, &Ctx](const CompoundStmt &Block,
+                                     LogExpansion &Expansion) {
+    const auto *Print = findPrintCall(Block);
+    if (!Print)
+      return false;
+    rewrite(*Print, Expansion, Ctx);
+    return true;
+  };
+  findLogStatements(*Result.SourceManager,
+                    const_cast<TranslationUnitDecl &>(*TU), Expansions,
+                    OnLogStatement);
+}
+
+void RosprintftofmtCheck::rewrite(const CallExpr &Print,
+                                  const LogExpansion &Logger,
+                                  ASTContext &Ctx) {
+  const SourceManager &Sm = Ctx.getSourceManager();
+  unsigned FormatIdx = Print.getDirectCallee()->getNumParams() - 1;
+  const auto *Format =
+      llvm::cast<StringLiteral>(Print.getArg(FormatIdx)->IgnoreParenImpCasts());
+  if (Format->getCharByteWidth() != 1) {
+    mir::noteSuppressedFix();
+    return;
+  }
+  llvm::ArrayRef<const Expr *> Args(Print.getArgs() + FormatIdx + 1,
+                                    Print.getNumArgs() - FormatIdx - 1);
+  FormatStringBuilder FSB(Sm, Saver, Logger);
+  PrintfConverter Converter(Ctx, Args, FSB);
+  if (!Converter.convert(Format->getString())) {
+    mir::noteSuppressedFix();
+    return;
+  }
+  llvm::SmallString<256> Buffer;
+  auto FormatString = FSB.getFormatString(Buffer);
+  auto Expand = Sm.getExpansionRange(Print.getSourceRange());
+  auto Diag = diag(Expand.getBegin(), "Rewrite to use format style instead %0",
+                   DiagnosticIDs::Warning);
+  Diag << FormatString
+       << FixItHint::CreateReplacement(Expand.getAsRange(), FormatString);
+  mir::noteFixIts(1);
+}
+
+}  // namespace modernize
+}  // namespace tidy
+}  // namespace clang
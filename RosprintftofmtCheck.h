@@ -0,0 +1,52 @@
+//===--- RosprintftofmtCheck.h - clang-tidy ---------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_ROSPRINTFTOFMTCHECK_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_ROSPRINTFTOFMTCHECK_H
+
+#include "RosLogMacros.h"
+#include "clang-tidy/ClangTidyCheck.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+/// Rewrites printf-style ROS_<LEVEL>[_<VARIANT>](fmt, ...) calls to their
+/// ROSFMT_* twins. Each conversion becomes a `{}` placeholder, with a format
+/// spec where printf's flags, width, precision or conversion would otherwise
+/// print differently; `.c_str()` and `std::to_string` wrappers that only
+/// existed to feed `%s` are dropped. A call is left alone if its format uses
+/// anything fmt cannot reproduce exactly: `*` widths, positional arguments,
+/// `%n`, `%p`, or a conversion whose argument type would print differently.
+class RosprintftofmtCheck : public ClangTidyCheck {
+public:
+  RosprintftofmtCheck(StringRef Name, ClangTidyContext *Context)
+      : ClangTidyCheck(Name, Context) {}
+  void registerPPCallbacks(const SourceManager &SM, Preprocessor *PP,
+                           Preprocessor *ModuleExpanderPP) override;
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+
+private:
+  void rewrite(const CallExpr &Print, const LogExpansion &Logger,
+               ASTContext &Ctx);
+
+  /// In source order, so range queries can binary search.
+  llvm::SmallVector<LogExpansion> Expansions;
+  llvm::BumpPtrAllocator Arena;
+  llvm::StringSaver Saver{Arena};
+};
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_ROSPRINTFTOFMTCHECK_H
@@ -9,7 +9,12 @@
 #ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_ROSSTREAMTOFMTCHECK_H
 #define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_ROSSTREAMTOFMTCHECK_H
 
+#include "RosLogMacros.h"
 #include "clang-tidy/ClangTidyCheck.h"
+#include "clang-tidy/utils/IncludeInserter.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
 
 namespace clang {
 namespace tidy {
@@ -21,10 +26,27 @@ namespace modernize {
 /// http://clang.llvm.org/extra/clang-tidy/checks/modernize-RosStreamToFmt.html
 class RosstreamtofmtCheck : public ClangTidyCheck {
 public:
-  RosstreamtofmtCheck(StringRef Name, ClangTidyContext *Context)
-      : ClangTidyCheck(Name, Context) {}
+  /// How the generated format string is checked. FMT_STRING and FMT_COMPILE
+  /// make fmt parse it, and match it against the arguments, at compile time.
+  enum class CompileTimeFormat { None, FmtString, FmtCompile };
+
+  RosstreamtofmtCheck(StringRef Name, ClangTidyContext *Context);
+  void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
+  void registerPPCallbacks(const SourceManager &SM, Preprocessor *PP,
+                           Preprocessor *ModuleExpanderPP) override;
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+
+private:
+  void rewrite(const CXXOperatorCallExpr &LogCode, const LogExpansion &Logger,
+               ASTContext &Ctx);
+
+  const CompileTimeFormat FormatCheck;
+  utils::IncludeInserter Inserter;
+  /// In source order, so range queries can binary search.
+  llvm::SmallVector<LogExpansion> Expansions;
+  llvm::BumpPtrAllocator Arena;
+  llvm::StringSaver Saver{Arena};
 };
 
 } // namespace modernize
@@ -0,0 +1,167 @@
+//===--- ServerSocket.cpp - mir-migrate -----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "ServerSocket.h"
+
+#include "llvm/Support/raw_ostream.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+namespace {
+
+/// How long a client may take to send its request.
+constexpr time_t RequestTimeoutSeconds = 10;
+
+bool writeAll(int FD, llvm::StringRef Data) {
+  while (!Data.empty()) {
+    ssize_t Written = ::write(FD, Data.data(), Data.size());
+    if (Written < 0 && errno == EINTR)
+      continue;
+    if (Written <= 0)
+      return false;
+    Data = Data.drop_front(Written);
+  }
+  return true;
+}
+
+/// Whether the client on \p Connection runs as the same user as the server.
+bool isSameUser(int Connection) {
+  ucred Credentials;
+  socklen_t Length = sizeof(Credentials);
+  return !::getsockopt(Connection, SOL_SOCKET, SO_PEERCRED, &Credentials,
+                       &Length) &&
+         Credentials.uid == ::getuid();
+}
+
+/// Reads NUL-terminated strings until an empty one.
+bool readRequest(int FD, ServerRequest &Request) {
+  std::vector<std::string> Fields;
+  std::string Current;
+  char Buffer[4096];
+  while (true) {
+    ssize_t Read = ::read(FD, Buffer, sizeof(Buffer));
+    if (Read < 0 && errno == EINTR)
+      continue;
+    if (Read <= 0)
+      return false;
+    for (char C : llvm::StringRef(Buffer, Read)) {
+      if (C) {
+        Current += C;
+        continue;
+      }
+      if (Current.empty()) {
+        if (Fields.empty())
+          return false;
+        Request.WorkingDirectory = std::move(Fields.front());
+        Request.Args.assign(std::make_move_iterator(Fields.begin() + 1),
+                            std::make_move_iterator(Fields.end()));
+        return true;
+      }
+      Fields.push_back(std::move(Current));
+      Current.clear();
+    }
+  }
+}
+
+} // namespace
+
+std::unique_ptr<ServerSocket> ServerSocket::listen(llvm::StringRef Path,
+                                                   std::string &Error) {
+  sockaddr_un Address = {};
+  Address.sun_family = AF_UNIX;
+  if (Path.size() >= sizeof(Address.sun_path)) {
+    Error = "socket path too long";
+    return nullptr;
+  }
+  std::memcpy(Address.sun_path, Path.data(), Path.size());
+
+  // A client that disconnects early must not kill the server mid-reply.
+  ::signal(SIGPIPE, SIG_IGN);
+  int FD = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (FD < 0) {
+    Error = std::strerror(errno);
+    return nullptr;
+  }
+  struct stat Existing;
+  if (!::lstat(Address.sun_path, &Existing) && S_ISSOCK(Existing.st_mode))
+    ::unlink(Address.sun_path);
+  // Requests can rewrite any file the server can, so the socket is created
+  // accessible to its user only.
+  mode_t OldMask = ::umask(077);
+  int Bound =
+      ::bind(FD, reinterpret_cast<sockaddr *>(&Address), sizeof(Address));
+  ::umask(OldMask);
+  if (Bound || ::listen(FD, 16)) {
+    Error = std::strerror(errno);
+    ::close(FD);
+    return nullptr;
+  }
+  return std::unique_ptr<ServerSocket>(new ServerSocket(FD, Path.str()));
+}
+
+ServerSocket::~ServerSocket() {
+  ::close(FD);
+  ::unlink(Path.c_str());
+}
+
+int ServerSocket::accept(ServerRequest &Request) {
+  while (true) {
+    int Connection = ::accept4(FD, nullptr, nullptr, SOCK_CLOEXEC);
+    if (Connection < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      return -1;
+    }
+    // A client that stalls mid-request must not block the server.
+    timeval Timeout = {RequestTimeoutSeconds, 0};
+    Request = {};
+    if (isSameUser(Connection) &&
+        !::setsockopt(Connection, SOL_SOCKET, SO_RCVTIMEO, &Timeout,
+                      sizeof(Timeout)) &&
+        readRequest(Connection, Request))
+      return Connection;
+    // A client that went away mid-request does not stop the server.
+    ::close(Connection);
+  }
+}
+
+RedirectOutput::RedirectOutput(int Connection)
+    : SavedStdout(::dup(STDOUT_FILENO)), SavedStderr(::dup(STDERR_FILENO)) {
+  llvm::outs().flush();
+  llvm::errs().flush();
+  ::dup2(Connection, STDOUT_FILENO);
+  ::dup2(Connection, STDERR_FILENO);
+}
+
+RedirectOutput::~RedirectOutput() {
+  llvm::outs().flush();
+  llvm::errs().flush();
+  ::dup2(SavedStdout, STDOUT_FILENO);
+  ::dup2(SavedStderr, STDERR_FILENO);
+  ::close(SavedStdout);
+  ::close(SavedStderr);
+}
+
+void finishReply(int Connection, int ExitCode) {
+  writeAll(Connection, llvm::StringRef("\0", 1));
+  writeAll(Connection, std::to_string(ExitCode));
+  ::close(Connection);
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,71 @@
+//===--- ServerSocket.h - mir-migrate ---------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_SERVERSOCKET_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_SERVERSOCKET_H
+
+#include "llvm/ADT/StringRef.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+/// One request to mir-migrate -serve. On the wire it is the client's working
+/// directory and its arguments, each terminated by a NUL byte, followed by
+/// one more NUL. The reply is the output the request produced, a NUL byte
+/// and the exit code in decimal.
+struct ServerRequest {
+  std::string WorkingDirectory;
+  std::vector<std::string> Args;
+};
+
+/// A Unix domain socket that serves one connection at a time.
+class ServerSocket {
+public:
+  /// Binds \p Path, replacing a stale socket file left by a previous server.
+  /// Only the current user can connect to it.
+  static std::unique_ptr<ServerSocket> listen(llvm::StringRef Path,
+                                              std::string &Error);
+  ~ServerSocket();
+
+  /// Waits for the next client and reads its request. Clients of other
+  /// users, and those that do not send a request within a few seconds, are
+  /// dropped. Returns the connection, or -1 on a failure that ends the
+  /// server.
+  int accept(ServerRequest &Request);
+
+private:
+  ServerSocket(int FD, std::string Path) : FD(FD), Path(std::move(Path)) {}
+
+  int FD;
+  std::string Path;
+};
+
+/// Sends the output written to stdout and stderr to \p Connection while
+/// alive. Used so that a request reports exactly what a standalone run would.
+class RedirectOutput {
+public:
+  explicit RedirectOutput(int Connection);
+  ~RedirectOutput();
+
+private:
+  int SavedStdout;
+  int SavedStderr;
+};
+
+/// Ends the reply on \p Connection with \p ExitCode and closes it.
+void finishReply(int Connection, int ExitCode);
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_SERVERSOCKET_H
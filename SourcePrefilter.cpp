@@ -0,0 +1,241 @@
+//===--- SourcePrefilter.cpp - mir-migrate --------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "SourcePrefilter.h"
+
+#include "clang-tidy/ClangTidyModule.h"
+#include "clang-tidy/ClangTidyModuleRegistry.h"
+#include "clang-tidy/utils/OptionsUtils.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+namespace {
+
+bool containsSubstring(StringRef Haystack, StringRef Needle) {
+  size_t N = Needle.size();
+  if (N == 0)
+    return true;
+  if (Haystack.size() < N)
+    return false;
+  size_t I = 0;
+#if defined(__SSE2__)
+  const char *Data = Haystack.data();
+  const __m128i First = _mm_set1_epi8(Needle.front());
+  const __m128i Last = _mm_set1_epi8(Needle.back());
+  // Block I covers the needle starting at positions I..I+15.
+  for (; I + N - 1 + 16 <= Haystack.size(); I += 16) {
+    __m128i BlockFirst =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(Data + I));
+    __m128i BlockLast =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(Data + I + N - 1));
+    unsigned Mask = _mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(First, BlockFirst), _mm_cmpeq_epi8(Last, BlockLast)));
+    while (Mask) {
+      unsigned Bit = llvm::countTrailingZeros(Mask);
+      if (std::memcmp(Data + I + Bit, Needle.data(), N) == 0)
+        return true;
+      Mask &= Mask - 1;
+    }
+  }
+#endif
+  return Haystack.substr(I).contains(Needle);
+}
+
+/// Returns the names of the `#include "..."` directives in \p Buffer.
+void scanQuotedIncludes(StringRef Buffer,
+                        llvm::SmallVectorImpl<StringRef> &Includes) {
+  while (!Buffer.empty()) {
+    StringRef Line;
+    std::tie(Line, Buffer) = Buffer.split('\n');
+    Line = Line.ltrim();
+    if (!Line.consume_front("#"))
+      continue;
+    Line = Line.ltrim();
+    if (!Line.consume_front("include"))
+      continue;
+    Line = Line.ltrim();
+    if (!Line.consume_front("\""))
+      continue;
+    size_t End = Line.find('"');
+    if (End != StringRef::npos)
+      Includes.push_back(Line.take_front(End));
+  }
+}
+
+/// Directories searched for quoted includes, in order, after the including
+/// file's own directory.
+std::vector<std::string>
+getQuoteSearchPath(const tooling::CompileCommand &Command) {
+  std::vector<std::string> Quote, Angled;
+  const auto &Args = Command.CommandLine;
+  for (size_t I = 0; I < Args.size(); ++I) {
+    StringRef Arg = Args[I];
+    std::vector<std::string> *Into = nullptr;
+    if (Arg.consume_front("-iquote"))
+      Into = &Quote;
+    else if (Arg.consume_front("-I"))
+      Into = &Angled;
+    else
+      continue;
+    if (Arg.empty() && I + 1 < Args.size())
+      Arg = Args[++I];
+    SmallString<256> Dir(Arg);
+    llvm::sys::fs::make_absolute(Command.Directory, Dir);
+    Into->push_back(Dir.str().str());
+  }
+  Quote.insert(Quote.end(), Angled.begin(), Angled.end());
+  return Quote;
+}
+
+} // namespace
+
+bool containsAnyOf(StringRef Haystack, llvm::ArrayRef<StringRef> Needles) {
+  for (StringRef Needle : Needles)
+    if (containsSubstring(Haystack, Needle))
+      return true;
+  return false;
+}
+
+llvm::ArrayRef<StringRef> SourcePrefilter::getCheckTokens(StringRef CheckName) {
+  // Only ROS_<LEVEL>* log macro expansions written in the main file are
+  // rewritten.
+  static const StringRef StreamTokens[] = {"_STREAM"};
+  static const StringRef PrintfTokens[] = {"ROS_DEBUG", "ROS_INFO", "ROS_WARN",
+                                           "ROS_ERROR", "ROS_FATAL"};
+  if (CheckName == "mir-rosstreamfmt" || CheckName == "mir-stringstreamfmt")
+    return StreamTokens;
+  if (CheckName == "mir-rosprintffmt")
+    return PrintfTokens;
+  // getParam, getParamCached, param and ros::param::*.
+  static const StringRef ParamTokens[] = {"param", "Param"};
+  if (CheckName == "mir-paramhoist")
+    return ParamTokens;
+  return {};
+}
+
+SourcePrefilter::SourcePrefilter(
+    const tooling::CompilationDatabase &Compilations, bool ScanIncludes)
+    : Compilations(Compilations), ScanIncludes(ScanIncludes) {
+  for (const auto &Entry : ClangTidyModuleRegistry::entries()) {
+    ClangTidyCheckFactories Factories;
+    Entry.instantiate()->addCheckFactories(Factories);
+    for (const auto &Factory : Factories)
+      CheckNames.push_back(Factory.getKey().str());
+  }
+}
+
+bool SourcePrefilter::canSkip(ClangTidyContext &Context,
+                              StringRef File) const {
+  Context.setCurrentFile(File);
+  if (Context.isCheckEnabled("clang-analyzer-") ||
+      Context.isCheckEnabled("clang-diagnostic-"))
+    return false;
+  llvm::SmallVector<StringRef, 4> Needles;
+  for (const std::string &Name : CheckNames) {
+    // mir-projectscope reports nothing; it only narrows the other checks.
+    if (!Context.isCheckEnabled(Name) || Name == "mir-projectscope")
+      continue;
+    // mir-lazylogargs only looks at calls to the wrappers it is configured
+    // with, and does nothing without any.
+    if (Name == "mir-lazylogargs") {
+      const auto &CheckOptions = Context.getOptions().CheckOptions;
+      auto Loggers = CheckOptions.find("mir-lazylogargs.EagerLoggers");
+      if (Loggers == CheckOptions.end())
+        continue;
+      for (StringRef Entry :
+           utils::options::parseStringList(Loggers->getValue().Value)) {
+        StringRef Logger = Entry.split('=').first.trim();
+        StringRef Unqualified = Logger.rsplit("::").second;
+        Needles.push_back(Unqualified.empty() ? Logger : Unqualified);
+      }
+      continue;
+    }
+    llvm::ArrayRef<StringRef> Tokens = getCheckTokens(Name);
+    if (Tokens.empty())
+      return false;
+    Needles.append(Tokens.begin(), Tokens.end());
+  }
+  if (Needles.empty())
+    return false;
+
+  if (ScanIncludes)
+    return !scanIncludes(File, Needles);
+  auto Buffer = llvm::MemoryBuffer::getFile(File);
+  if (!Buffer)
+    return false;
+  return !containsAnyOf((*Buffer)->getBuffer(), Needles);
+}
+
+/// Searches \p File and every header it reaches through quoted includes.
+/// Returns true on a match or if \p File cannot be read.
+bool SourcePrefilter::scanIncludes(StringRef File,
+                                   llvm::ArrayRef<StringRef> Needles) const {
+  std::vector<tooling::CompileCommand> Commands =
+      Compilations.getCompileCommands(File);
+  if (Commands.empty())
+    return true;
+  std::vector<std::string> SearchPath = getQuoteSearchPath(Commands.front());
+
+  SmallString<256> MainFile(File);
+  llvm::sys::fs::make_absolute(Commands.front().Directory, MainFile);
+  llvm::StringSet<> Seen;
+  std::vector<std::string> Worklist{MainFile.str().str()};
+  Seen.insert(Worklist.back());
+  while (!Worklist.empty()) {
+    std::string Current = std::move(Worklist.back());
+    Worklist.pop_back();
+    auto Buffer = llvm::MemoryBuffer::getFile(Current);
+    if (!Buffer) {
+      if (Current == MainFile.str())
+        return true;
+      continue;
+    }
+    StringRef Code = (*Buffer)->getBuffer();
+    if (containsAnyOf(Code, Needles))
+      return true;
+
+    llvm::SmallVector<StringRef, 16> Includes;
+    scanQuotedIncludes(Code, Includes);
+    StringRef CurrentDir = llvm::sys::path::parent_path(Current);
+    for (StringRef Include : Includes) {
+      auto TryDir = [&](StringRef Dir) {
+        SmallString<256> Candidate(Dir);
+        llvm::sys::path::append(Candidate, Include);
+        llvm::sys::path::remove_dots(Candidate, /*remove_dot_dot=*/true);
+        if (!llvm::sys::fs::is_regular_file(Candidate))
+          return false;
+        if (Seen.insert(Candidate).second)
+          Worklist.push_back(Candidate.str().str());
+        return true;
+      };
+      if (TryDir(CurrentDir))
+        continue;
+      for (const std::string &Dir : SearchPath)
+        if (TryDir(Dir))
+          break;
+    }
+  }
+  return false;
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,63 @@
+//===--- SourcePrefilter.h - mir-migrate ------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_SOURCEPREFILTER_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_SOURCEPREFILTER_H
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+/// Returns true if any of \p Needles occurs in \p Haystack. Uses SSE2 where
+/// available: 16 candidate positions are tested at once against the first
+/// and last byte of a needle, and only positions matching both are compared
+/// in full.
+bool containsAnyOf(StringRef Haystack, llvm::ArrayRef<StringRef> Needles);
+
+/// Decides, from raw bytes only, whether a translation unit can contain
+/// anything the enabled checks would report.
+///
+/// Checks that only fire on code spelled in the main file list the tokens
+/// they need in getCheckTokens(). A TU is skipped when every check enabled
+/// for it has such a list and none of the tokens occurs in the main file
+/// (or, with \p ScanIncludes, in any header it reaches through quoted
+/// includes). Any other enabled check, including clang-analyzer-* and
+/// clang-diagnostic-*, keeps the TU.
+class SourcePrefilter {
+public:
+  SourcePrefilter(const tooling::CompilationDatabase &Compilations,
+                  bool ScanIncludes);
+
+  /// Thread-safe as long as each thread passes its own \p Context.
+  bool canSkip(ClangTidyContext &Context, StringRef File) const;
+
+  /// The tokens whose absence proves \p CheckName has nothing to report, or
+  /// an empty list if the check cannot be prefiltered.
+  static llvm::ArrayRef<StringRef> getCheckTokens(StringRef CheckName);
+
+private:
+  bool scanIncludes(StringRef File, llvm::ArrayRef<StringRef> Needles) const;
+
+  const tooling::CompilationDatabase &Compilations;
+  bool ScanIncludes;
+  /// Every check registered by a linked module.
+  std::vector<std::string> CheckNames;
+};
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_SOURCEPREFILTER_H
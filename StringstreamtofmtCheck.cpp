@@ -0,0 +1,225 @@
+//===--- StringstreamtofmtCheck.cpp - clang-tidy --------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "StringstreamtofmtCheck.h"
+#include "CheckMetrics.h"
+#include "FormatStringBuilder.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "utils.hpp"
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+namespace {
+
+class VarRefCounter : public RecursiveASTVisitor<VarRefCounter> {
+public:
+  explicit VarRefCounter(const VarDecl &Var) : Var(Var) {}
+
+  bool VisitDeclRefExpr(DeclRefExpr *Ref) {
+    if (Ref->getDecl() == &Var)
+      ++Count;
+    return true;
+  }
+
+  unsigned Count = 0;
+
+private:
+  const VarDecl &Var;
+};
+
+unsigned countRefs(const Stmt &S, const VarDecl &Var) {
+  VarRefCounter Counter(Var);
+  Counter.TraverseStmt(const_cast<Stmt *>(&S));
+  return Counter.Count;
+}
+
+bool refersTo(const Expr *E, const VarDecl &Var) {
+  const auto *Ref = llvm::dyn_cast_or_null<DeclRefExpr>(E);
+  return Ref && Ref->getDecl() == &Var;
+}
+
+/// `Var.str()`.
+bool isStrCall(const Expr &E, const VarDecl &Var) {
+  const auto *Call = llvm::dyn_cast<CXXMemberCallExpr>(E.IgnoreImplicit());
+  if (!Call || Call->getNumArgs() != 0)
+    return false;
+  const CXXMethodDecl *Method = Call->getMethodDecl();
+  return Method && Method->getIdentifier() &&
+         Method->getIdentifier()->isStr("str") &&
+         refersTo(Call->getImplicitObjectArgument()->IgnoreParenImpCasts(),
+                  Var);
+}
+
+/// Only the defaulted constructor; an initial string or openmode would have
+/// to be reproduced.
+bool isDefaultConstructed(const VarDecl &Var) {
+  const auto *Construct =
+      llvm::dyn_cast_or_null<CXXConstructExpr>(Var.getInit());
+  return Construct &&
+         llvm::all_of(Construct->arguments(), [](const Expr *Arg) {
+           return llvm::isa<CXXDefaultArgExpr>(Arg);
+         });
+}
+
+bool isInMainFile(const Stmt &S, const SourceManager &Sm) {
+  return S.getBeginLoc().isFileID() && S.getEndLoc().isFileID() &&
+         Sm.isInMainFile(S.getBeginLoc());
+}
+
+} // namespace
+
+void StringstreamtofmtCheck::registerPPCallbacks(
+    const SourceManager &SM, Preprocessor *PP,
+    Preprocessor *ModuleExpanderPP) {
+  Expansions.clear();
+  PP->addPPCallbacks(createLogMacroCollector(SM, PP->getLangOpts(),
+                                             RosLogFamily::Stream, Expansions));
+}
+
+void StringstreamtofmtCheck::registerMatchers(MatchFinder *Finder) {
+  auto StringStream = cxxRecordDecl(
+      hasAnyName("::std::basic_stringstream", "::std::basic_ostringstream"));
+  Finder->addMatcher(
+      declStmt(hasSingleDecl(
+                   varDecl(hasLocalStorage(), isExpansionInMainFile(),
+                           unless(isInTemplateInstantiation()),
+                           hasType(hasUnqualifiedDesugaredType(
+                               recordType(hasDeclaration(StringStream)))))
+                       .bind("stream")),
+               hasParent(compoundStmt().bind("block")))
+          .bind("decl"),
+      this);
+}
+
+LogExpansion *StringstreamtofmtCheck::findExpansion(const Stmt &S,
+                                                    const SourceManager &Sm) {
+  if (!S.getBeginLoc().isMacroID())
+    return nullptr;
+  auto [Fid, Offset] = Sm.getDecomposedExpansionLoc(S.getBeginLoc());
+  if (Fid != Sm.getMainFileID())
+    return nullptr;
+  auto *It = llvm::partition_point(
+      Expansions, [Offset = Offset](const auto &E) { return E.Begin < Offset; });
+  if (It == Expansions.end() || It->Begin != Offset)
+    return nullptr;
+  return It;
+}
+
+void StringstreamtofmtCheck::check(const MatchFinder::MatchResult &Result) {
+  const auto *Var = Result.Nodes.getNodeAs<VarDecl>("stream");
+  const auto *Declaration = Result.Nodes.getNodeAs<DeclStmt>("decl");
+  const auto *Block = Result.Nodes.getNodeAs<CompoundStmt>("block");
+  if (Expansions.empty() || !isDefaultConstructed(*Var))
+    return;
+  ASTContext &Ctx = *Result.Context;
+  const SourceManager &Sm = Ctx.getSourceManager();
+  if (!isInMainFile(*Declaration, Sm))
+    return;
+
+  // The appends have to run right before the log statement, so moving
+  // their operands into it does not reorder anything.
+  llvm::SmallVector<const Stmt *, 4> Appends;
+  llvm::SmallVector<const Expr *, 16> Appended;
+  const Stmt *Log = nullptr;
+  auto It = llvm::find(Block->body(), Declaration);
+  for (++It; It != Block->body_end(); ++It) {
+    const Stmt *S = *It;
+    unsigned Refs = countRefs(*S, *Var);
+    if (Log) {
+      if (Refs)
+        return;
+      continue;
+    }
+    if (!Refs) {
+      if (!Appends.empty())
+        return;
+      continue;
+    }
+    if (const auto *Chain = llvm::dyn_cast<Expr>(S)) {
+      size_t First = Appended.size();
+      if (Refs == 1 && isInMainFile(*S, Sm) &&
+          refersTo(splitStreamChain(*Chain->IgnoreImplicit(), Appended),
+                   *Var)) {
+        Appends.push_back(S);
+        continue;
+      }
+      Appended.resize(First);
+    }
+    if (Refs != 1 || Appends.empty())
+      return;
+    Log = S;
+  }
+  LogExpansion *Expansion = Log ? findExpansion(*Log, Sm) : nullptr;
+  if (!Expansion || Expansion->Handled)
+    return;
+  const auto *LogChain = findRosconsoleStreamChain(*Log);
+  if (!LogChain)
+    return;
+
+  for (const Expr *Operand : Appended)
+    if (isStreamManipulator(*Operand) || Operand->HasSideEffects(Ctx))
+      return;
+  llvm::SmallVector<const Expr *, 16> LogOperands;
+  splitStreamChain(*LogChain, LogOperands);
+  llvm::SmallVector<const Expr *, 16> Operands;
+  bool FoundStr = false;
+  for (const Expr *Operand : LogOperands) {
+    if (isStrCall(*Operand, *Var)) {
+      FoundStr = true;
+      Operands.append(Appended.begin(), Appended.end());
+    } else if (Operand->HasSideEffects(Ctx)) {
+      // The appended operands would now be evaluated after it.
+      return;
+    } else {
+      Operands.push_back(Operand);
+    }
+  }
+  if (!FoundStr)
+    return;
+
+  llvm::SmallVector<const Stmt *, 4> Removed = {Declaration};
+  Removed.append(Appends.begin(), Appends.end());
+  llvm::SmallVector<CharSourceRange, 4> Removals;
+  for (const Stmt *S : Removed) {
+    CharSourceRange Range =
+        getStatementRemovalRange(*S, Sm, Ctx.getLangOpts());
+    if (Range.isInvalid()) {
+      mir::noteSuppressedFix();
+      return;
+    }
+    Removals.push_back(Range);
+  }
+
+  Expansion->Handled = true;
+  FormatStringBuilder FSB(Sm, Saver, *Expansion);
+  FSB.addStreamOperands(Operands, Ctx);
+  llvm::SmallString<256> Buffer;
+  auto FormatString = FSB.getFormatString(Buffer);
+  auto Expand = Sm.getExpansionRange(LogChain->getSourceRange());
+  auto Diag = diag(Expand.getBegin(), "Fold stringstream '%0' into %1",
+                   DiagnosticIDs::Warning);
+  Diag << Var->getName() << FormatString
+       << FixItHint::CreateReplacement(Expand.getAsRange(), FormatString);
+  for (const CharSourceRange &Range : Removals)
+    Diag << FixItHint::CreateRemoval(Range);
+  mir::noteFixIts(1 + Removals.size());
+}
+
+}  // namespace modernize
+}  // namespace tidy
+}  // namespace clang
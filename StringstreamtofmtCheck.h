@@ -0,0 +1,56 @@
+//===--- StringstreamtofmtCheck.h - clang-tidy ------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_STRINGSTREAMTOFMTCHECK_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_STRINGSTREAMTOFMTCHECK_H
+
+#include "RosLogMacros.h"
+#include "clang-tidy/ClangTidyCheck.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
+
+namespace clang {
+namespace tidy {
+namespace modernize {
+
+/// Folds a local std::stringstream that only builds one log message,
+///
+///   std::stringstream ss;
+///   ss << "x=" << x;
+///   ss << ", y=" << y;
+///   ROS_INFO_STREAM(ss.str());
+///
+/// into a single ROSFMT_INFO("x={}, y={}", x, y) and deletes the stream.
+/// The appends must directly precede the log statement in the declaring
+/// block and be the stream's only other uses; manipulators and operands with
+/// side effects keep the code as is.
+class StringstreamtofmtCheck : public ClangTidyCheck {
+public:
+  StringstreamtofmtCheck(StringRef Name, ClangTidyContext *Context)
+      : ClangTidyCheck(Name, Context) {}
+  void registerPPCallbacks(const SourceManager &SM, Preprocessor *PP,
+                           Preprocessor *ModuleExpanderPP) override;
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+
+private:
+  /// The recorded expansion starting where \p S does, if any.
+  LogExpansion *findExpansion(const Stmt &S, const SourceManager &Sm);
+
+  /// In source order, so lookups can binary search.
+  llvm::SmallVector<LogExpansion> Expansions;
+  llvm::BumpPtrAllocator Arena;
+  llvm::StringSaver Saver{Arena};
+};
+
+} // namespace modernize
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MODERNIZE_STRINGSTREAMTOFMTCHECK_H
@@ -0,0 +1,122 @@
+//===--- TuFingerprint.cpp - mir-migrate ----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "TuFingerprint.h"
+
+#include "clang/Basic/DiagnosticOptions.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/Preprocessor.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/MD5.h"
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+namespace {
+
+class EnteredFilesCollector : public PPCallbacks {
+public:
+  EnteredFilesCollector(const SourceManager &Sm, llvm::MD5 &Hash,
+                        std::vector<std::string> &Files)
+      : Sm(Sm), Hash(Hash), Files(Files) {}
+
+  void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                   SrcMgr::CharacteristicKind FileType,
+                   FileID PrevFID) override {
+    if (Reason != EnterFile)
+      return;
+    FileID Fid = Sm.getFileID(Loc);
+    const FileEntry *Entry = Sm.getFileEntryForID(Fid);
+    if (!Entry || !Seen.insert(Entry).second)
+      return;
+    Files.push_back(Entry->getName().str());
+    Hash.update(Entry->getName());
+    Hash.update(Sm.getBufferData(Fid));
+  }
+
+private:
+  const SourceManager &Sm;
+  llvm::MD5 &Hash;
+  std::vector<std::string> &Files;
+  llvm::DenseSet<const FileEntry *> Seen;
+};
+
+class FingerprintAction : public PreprocessorFrontendAction {
+public:
+  explicit FingerprintAction(TuFingerprint &Result) : Result(Result) {}
+
+protected:
+  void ExecuteAction() override {
+    CompilerInstance &CI = getCompilerInstance();
+    Preprocessor &PP = CI.getPreprocessor();
+    llvm::MD5 Hash;
+    PP.addPPCallbacks(std::make_unique<EnteredFilesCollector>(
+        CI.getSourceManager(), Hash, Result.Files));
+    PP.EnterMainSourceFile();
+    Token Tok;
+    do {
+      PP.Lex(Tok);
+      Hash.update(PP.getSpelling(Tok));
+      Hash.update(Tok.isAtStartOfLine() ? "\n" : " ");
+    } while (Tok.isNot(tok::eof));
+    llvm::MD5::MD5Result Digest;
+    Hash.final(Digest);
+    Result.Digest = Digest.digest().str().str();
+  }
+
+private:
+  TuFingerprint &Result;
+};
+
+class FingerprintActionFactory : public tooling::FrontendActionFactory {
+public:
+  explicit FingerprintActionFactory(TuFingerprint &Result) : Result(Result) {}
+
+  std::unique_ptr<FrontendAction> create() override {
+    return std::make_unique<FingerprintAction>(Result);
+  }
+
+  bool runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
+                     FileManager *Files,
+                     std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+                     DiagnosticConsumer *DiagConsumer) override {
+    // Preprocess exactly like clang-tidy will, which defines
+    // __clang_analyzer__.
+    Invocation->getPreprocessorOpts().SetUpStaticAnalyzer = true;
+    return FrontendActionFactory::runInvocation(
+        Invocation, Files, std::move(PCHContainerOps), DiagConsumer);
+  }
+
+private:
+  TuFingerprint &Result;
+};
+
+} // namespace
+
+bool computeFingerprint(const tooling::CompilationDatabase &Compilations,
+                        StringRef File,
+                        llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS,
+                        TuFingerprint &Result) {
+  Result = TuFingerprint();
+  tooling::ClangTool Tool(Compilations, {File.str()},
+                          std::make_shared<PCHContainerOperations>(),
+                          std::move(FS));
+  IgnoringDiagConsumer IgnoreDiagnostics;
+  Tool.setDiagnosticConsumer(&IgnoreDiagnostics);
+  FingerprintActionFactory Factory(Result);
+  return Tool.run(&Factory) == 0 && !Result.Digest.empty();
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,43 @@
+//===--- TuFingerprint.h - mir-migrate --------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_TUFINGERPRINT_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_TUFINGERPRINT_H
+
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+/// What a translation unit looks like after preprocessing.
+struct TuFingerprint {
+  /// MD5 (hex) over the preprocessed token stream and the raw bytes of every
+  /// file the preprocessor entered. The token stream captures macro and flag
+  /// effects; the raw bytes make sure cached diagnostic offsets and fix-it
+  /// ranges are still valid after whitespace-only edits.
+  std::string Digest;
+  /// Every file entered during preprocessing, main file first.
+  std::vector<std::string> Files;
+};
+
+/// Runs only the preprocessor over \p File using its compile command from
+/// \p Compilations. Returns false if the file could not be preprocessed.
+bool computeFingerprint(const tooling::CompilationDatabase &Compilations,
+                        StringRef File,
+                        llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS,
+                        TuFingerprint &Result);
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_TUFINGERPRINT_H
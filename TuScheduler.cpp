@@ -0,0 +1,117 @@
+//===--- TuScheduler.cpp - mir-migrate ------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "TuScheduler.h"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <thread>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+namespace {
+struct WorkerQueue {
+  std::mutex Lock;
+  std::deque<const TuJob *> Jobs;
+};
+
+const TuJob *popFront(WorkerQueue &Queue) {
+  std::lock_guard<std::mutex> Guard(Queue.Lock);
+  if (Queue.Jobs.empty())
+    return nullptr;
+  const TuJob *Job = Queue.Jobs.front();
+  Queue.Jobs.pop_front();
+  return Job;
+}
+
+const TuJob *popBack(WorkerQueue &Queue) {
+  std::lock_guard<std::mutex> Guard(Queue.Lock);
+  if (Queue.Jobs.empty())
+    return nullptr;
+  const TuJob *Job = Queue.Jobs.back();
+  Queue.Jobs.pop_back();
+  return Job;
+}
+} // namespace
+
+TuScheduler::TuScheduler(unsigned NumWorkers)
+    : NumWorkers(std::max(1u, NumWorkers)) {}
+
+void TuScheduler::run(
+    std::vector<TuJob> Jobs,
+    llvm::function_ref<void(unsigned Worker, const TuJob &Job)> Work) {
+  std::stable_sort(Jobs.begin(), Jobs.end(),
+                   [](const TuJob &A, const TuJob &B) {
+                     return A.EstimatedCost > B.EstimatedCost;
+                   });
+
+  std::vector<std::unique_ptr<WorkerQueue>> Queues;
+  for (unsigned I = 0; I < NumWorkers; ++I)
+    Queues.push_back(std::make_unique<WorkerQueue>());
+  for (size_t I = 0; I < Jobs.size(); ++I)
+    Queues[I % NumWorkers]->Jobs.push_back(&Jobs[I]);
+
+  auto Next = [&](unsigned Worker) -> const TuJob * {
+    if (const TuJob *Job = popFront(*Queues[Worker]))
+      return Job;
+    for (unsigned Offset = 1; Offset < NumWorkers; ++Offset)
+      if (const TuJob *Job = popBack(*Queues[(Worker + Offset) % NumWorkers]))
+        return Job;
+    return nullptr;
+  };
+
+  // Jobs are never added after this point, so a worker that finds every
+  // queue empty is done.
+  std::vector<std::thread> Threads;
+  for (unsigned Worker = 0; Worker < NumWorkers; ++Worker) {
+    Threads.emplace_back([&, Worker] {
+      while (const TuJob *Job = Next(Worker))
+        Work(Worker, *Job);
+    });
+  }
+  for (auto &Thread : Threads)
+    Thread.join();
+}
+
+std::vector<std::vector<size_t>> assignShards(const std::vector<TuJob> &Jobs,
+                                              unsigned NumShards,
+                                              std::vector<uint64_t> &Loads) {
+  NumShards = std::max(1u, NumShards);
+  std::vector<size_t> Order(Jobs.size());
+  std::iota(Order.begin(), Order.end(), 0);
+  std::stable_sort(Order.begin(), Order.end(), [&](size_t A, size_t B) {
+    return Jobs[A].EstimatedCost > Jobs[B].EstimatedCost;
+  });
+
+  // Lightest shard first; ties go to the lower shard number.
+  using Entry = std::pair<uint64_t, unsigned>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> Lightest;
+  for (unsigned I = 0; I < NumShards; ++I)
+    Lightest.push({0, I});
+  std::vector<std::vector<size_t>> Shards(NumShards);
+  Loads.assign(NumShards, 0);
+  for (size_t Job : Order) {
+    auto [Load, Shard] = Lightest.top();
+    Lightest.pop();
+    Shards[Shard].push_back(Job);
+    Loads[Shard] = Load + Jobs[Job].EstimatedCost;
+    Lightest.push({Loads[Shard], Shard});
+  }
+  return Shards;
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
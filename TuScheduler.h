@@ -0,0 +1,65 @@
+//===--- TuScheduler.h - mir-migrate ----------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_TUSCHEDULER_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_TUSCHEDULER_H
+
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+/// One translation unit to analyze.
+struct TuJob {
+  std::string File;
+  /// Relative cost used for largest-first ordering, e.g. the main file size.
+  uint64_t EstimatedCost = 0;
+  /// Position in the compilation database; results are merged in this order.
+  size_t Index = 0;
+};
+
+/// Runs translation units on a fixed set of worker threads.
+///
+/// Jobs are sorted by descending estimated cost and dealt round-robin into
+/// one queue per worker. A worker takes the largest job from the front of
+/// its own queue and, once that is empty, steals the smallest job from the
+/// back of another worker's queue, so a few huge TUs never leave the other
+/// threads idle at the end of a run.
+class TuScheduler {
+public:
+  explicit TuScheduler(unsigned NumWorkers);
+
+  /// Calls \p Work once for every job and blocks until all have finished.
+  /// \p Work receives the index of the calling worker, which is stable for
+  /// the lifetime of the thread and below getNumWorkers().
+  void run(std::vector<TuJob> Jobs,
+           llvm::function_ref<void(unsigned Worker, const TuJob &Job)> Work);
+
+  unsigned getNumWorkers() const { return NumWorkers; }
+
+private:
+  unsigned NumWorkers;
+};
+
+/// Splits \p Jobs into \p NumShards lists of about equal total estimated
+/// cost with the longest-processing-time rule: jobs in descending cost order,
+/// each to the shard with the least cost so far. Returns indices into
+/// \p Jobs and stores each shard's total cost in \p Loads.
+std::vector<std::vector<size_t>> assignShards(const std::vector<TuJob> &Jobs,
+                                              unsigned NumShards,
+                                              std::vector<uint64_t> &Loads);
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_TUSCHEDULER_H
@@ -0,0 +1,127 @@
+//===--- TuTimings.cpp - mir-migrate --------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "TuTimings.h"
+#include "IncludeIndex.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+static uint64_t getFileSize(llvm::StringRef File) {
+  uint64_t Size = 0;
+  if (llvm::sys::fs::file_size(File, Size))
+    return 0;
+  return Size;
+}
+
+TuTimings TuTimings::load(llvm::StringRef Path) {
+  TuTimings Timings;
+  auto Buffer = llvm::MemoryBuffer::getFile(Path, /*IsText=*/true);
+  if (!Buffer)
+    return Timings;
+  llvm::StringRef Rest = (*Buffer)->getBuffer();
+  while (!Rest.empty()) {
+    llvm::StringRef Line;
+    std::tie(Line, Rest) = Rest.split('\n');
+    llvm::StringRef Time, File;
+    std::tie(Time, File) = Line.split(' ');
+    uint64_t Nanos;
+    // Lines that do not parse, e.g. from an interrupted write, are skipped.
+    if (File.empty() || Time.getAsInteger(10, Nanos))
+      continue;
+    Timings.record(File, Nanos);
+  }
+  return Timings;
+}
+
+void TuTimings::record(llvm::StringRef File, uint64_t Nanos) {
+  Timing &T = Times[File];
+  T.Total += Nanos;
+  ++T.Count;
+}
+
+uint64_t TuTimings::lookup(llvm::StringRef File) const {
+  auto It = Times.find(File);
+  return It == Times.end() ? 0 : It->second.Total / It->second.Count;
+}
+
+std::vector<std::pair<llvm::StringRef, uint64_t>>
+TuTimings::getEntries() const {
+  std::vector<std::pair<llvm::StringRef, uint64_t>> Entries;
+  for (const auto &Entry : Times)
+    Entries.emplace_back(Entry.getKey(),
+                         Entry.second.Total / Entry.second.Count);
+  return Entries;
+}
+
+bool TuTimings::write(llvm::StringRef Path,
+                      llvm::Optional<llvm::ArrayRef<std::string>> Only) const {
+  int FD;
+  llvm::SmallString<256> TmpPath;
+  if (llvm::sys::fs::createUniqueFile(Path + ".tmp-%%%%%%%%", FD, TmpPath))
+    return false;
+  {
+    llvm::raw_fd_ostream Out(FD, /*shouldClose=*/true);
+    if (Only) {
+      for (const std::string &File : *Only)
+        if (uint64_t Nanos = lookup(File))
+          Out << Nanos << ' ' << File << '\n';
+    } else {
+      for (const auto &[File, Nanos] : getEntries())
+        Out << Nanos << ' ' << File << '\n';
+    }
+  }
+  if (llvm::sys::fs::rename(TmpPath, Path)) {
+    llvm::sys::fs::remove(TmpPath);
+    return false;
+  }
+  return true;
+}
+
+TuCostModel::TuCostModel(const TuTimings &Timings, const IncludeIndex *Index)
+    : Timings(Timings), Index(Index) {
+  // Ratios of sums rather than means of ratios, so that tiny TUs with a
+  // large fixed cost do not dominate the fit.
+  uint64_t IncludeNanos = 0, NumIncludes = 0, ByteNanos = 0, NumBytes = 0;
+  for (const auto &[File, Nanos] : Timings.getEntries()) {
+    if (Index) {
+      if (size_t Count = Index->getFiles(File).size()) {
+        IncludeNanos += Nanos;
+        NumIncludes += Count;
+      }
+    }
+    if (uint64_t Size = getFileSize(File)) {
+      ByteNanos += Nanos;
+      NumBytes += Size;
+    }
+  }
+  if (NumIncludes)
+    NanosPerInclude = double(IncludeNanos) / NumIncludes;
+  if (NumBytes)
+    NanosPerByte = double(ByteNanos) / NumBytes;
+}
+
+uint64_t TuCostModel::estimate(llvm::StringRef File) const {
+  if (uint64_t Nanos = Timings.lookup(File))
+    return Nanos;
+  if (Index && NanosPerInclude > 0)
+    if (size_t Count = Index->getFiles(File).size())
+      return Count * NanosPerInclude;
+  uint64_t Size = getFileSize(File);
+  return NanosPerByte > 0 ? Size * NanosPerByte : Size;
+}
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
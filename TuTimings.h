@@ -0,0 +1,85 @@
+//===--- TuTimings.h - mir-migrate ------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_TUTIMINGS_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_TUTIMINGS_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace mir {
+
+class IncludeIndex;
+
+/// Analysis time per translation unit, measured by earlier runs.
+///
+/// The file is text, one "<nanoseconds> <path>" line per TU, so that the
+/// files written by several CI shards can simply be concatenated. Each
+/// shard writes only its own TUs, and lines for the same TU are folded
+/// together as by record().
+class TuTimings {
+public:
+  /// Reads \p Path. A missing file gives an empty database.
+  static TuTimings load(llvm::StringRef Path);
+
+  /// Folds a new measurement into the mean of those on record for \p File,
+  /// so that one noisy run does not move a TU to another shard.
+  void record(llvm::StringRef File, uint64_t Nanos);
+
+  /// The mean time on record for \p File, or 0.
+  uint64_t lookup(llvm::StringRef File) const;
+
+  /// Every TU on record with its mean time.
+  std::vector<std::pair<llvm::StringRef, uint64_t>> getEntries() const;
+
+  /// Atomically replaces \p Path with the mean times of \p Only, or of
+  /// every TU on record.
+  bool write(llvm::StringRef Path,
+             llvm::Optional<llvm::ArrayRef<std::string>> Only = llvm::None)
+      const;
+
+private:
+  struct Timing {
+    uint64_t Total = 0;
+    unsigned Count = 0;
+  };
+
+  llvm::StringMap<Timing> Times;
+};
+
+/// Predicts the analysis time of a TU in nanoseconds: the recorded time if
+/// there is one, otherwise its include count (from \p Index) or main file
+/// size, scaled by the time per include or per byte of the timed TUs. With
+/// no timings at all, the main file size is used unscaled, which still
+/// orders TUs consistently.
+class TuCostModel {
+public:
+  TuCostModel(const TuTimings &Timings, const IncludeIndex *Index);
+
+  uint64_t estimate(llvm::StringRef File) const;
+
+private:
+  const TuTimings &Timings;
+  const IncludeIndex *Index;
+  double NanosPerInclude = 0;
+  double NanosPerByte = 0;
+};
+
+} // namespace mir
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MIR_TUTIMINGS_H
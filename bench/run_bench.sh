@@ -0,0 +1,72 @@
+#!/bin/bash
+# --- begin runfiles.bash initialization v2 ---
+# Copy-pasted from the Bazel Bash runfiles library v2.
+set -uo pipefail; set +e; f=bazel_tools/tools/bash/runfiles/runfiles.bash
+source "${RUNFILES_DIR:-/dev/null}/$f" 2>/dev/null || \
+  source "$(grep -sm1 "^$f " "${RUNFILES_MANIFEST_FILE:-/dev/null}" | cut -f2- -d' ')" 2>/dev/null || \
+  source "$0.runfiles/$f" 2>/dev/null || \
+  source "$(grep -sm1 "^$f " "$0.runfiles_manifest" | cut -f2- -d' ')" 2>/dev/null || \
+  source "$(grep -sm1 "^$f " "$0.exe.runfiles_manifest" | cut -f2- -d' ')" 2>/dev/null || \
+  { echo>&2 "ERROR: cannot find $f"; exit 1; }; f=; set -e
+# --- end runfiles.bash initialization v2 ---
+
+# Generates a synthetic code base and runs each mir-* check over it on its
+# own. Arguments are passed to synthetic_ros_gen, e.g.
+#   bazel run //:bench -- --tus=200 --log-calls=500
+# By default every check the plugin lists is run, except mir-projectscope,
+# which reports nothing on its own. Set CHECKS to a space separated list to
+# benchmark a subset.
+
+CT=$(rlocation llvm_toolchain_llvm/bin/clang-tidy)
+PLUGIN=$(rlocation external-tidy-module/custom_plugin.so)
+GEN=$(rlocation external-tidy-module/synthetic_ros_gen)
+if [[ -z "${CHECKS:-}" ]]; then
+  CHECKS=$("$CT" -load="$PLUGIN" -checks="-*,mir-*" -list-checks |
+    grep -o 'mir-[a-z]*' | grep -vx mir-projectscope | tr '\n' ' ')
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+"$GEN" --out="$WORK/src" "$@"
+FILES=$(ls "$WORK"/src/tu_*.cpp)
+
+TIME_BIN=""
+if [[ -x /usr/bin/time ]]; then
+  TIME_BIN=/usr/bin/time
+fi
+
+printf "%-18s %10s %12s %14s %8s\n" check wall_s matcher_s peak_rss_kb fixits
+for CHECK in $CHECKS; do
+  PROFILE="$WORK/profile-$CHECK"
+  FIXES="$WORK/fixes-$CHECK.yaml"
+  RSS_LOG="$WORK/rss-$CHECK"
+  mkdir -p "$PROFILE"
+  START=$(date +%s%N)
+  if [[ -n "$TIME_BIN" ]]; then
+    $TIME_BIN -f %M -o "$RSS_LOG" "$CT" -load="$PLUGIN" -checks="-*,$CHECK" \
+      -header-filter=".*" -p "$WORK/src" -enable-check-profile \
+      -store-check-profile="$PROFILE" -export-fixes="$FIXES" $FILES \
+      >/dev/null 2>&1 || true
+  else
+    "$CT" -load="$PLUGIN" -checks="-*,$CHECK" -header-filter=".*" \
+      -p "$WORK/src" -enable-check-profile -store-check-profile="$PROFILE" \
+      -export-fixes="$FIXES" $FILES >/dev/null 2>&1 || true
+  fi
+  END=$(date +%s%N)
+
+  WALL=$(awk -v s="$START" -v e="$END" 'BEGIN { printf "%.3f", (e - s) / 1e9 }')
+  # -store-check-profile writes one JSON file per TU with
+  # "time.clang-tidy.<check>.wall" entries.
+  MATCHER=$(cat "$PROFILE"/*.json 2>/dev/null |
+    awk -F': ' -v key="\"time.clang-tidy.$CHECK.wall\"" \
+      '$1 ~ key { gsub(/,/, "", $2); sum += $2 } END { printf "%.3f", sum }')
+  RSS="n/a"
+  if [[ -s "$RSS_LOG" ]]; then
+    RSS=$(tail -n1 "$RSS_LOG")
+  fi
+  FIXITS=0
+  if [[ -f "$FIXES" ]]; then
+    FIXITS=$(grep -c "ReplacementText" "$FIXES" || true)
+  fi
+  printf "%-18s %10s %12s %14s %8s\n" "$CHECK" "$WALL" "$MATCHER" "$RSS" "$FIXITS"
+done
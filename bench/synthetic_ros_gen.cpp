@@ -0,0 +1,192 @@
+// Generates a synthetic ROS-style code base for benchmarking the mir-* checks.
+//
+// The output directory gets a compile_commands.json, a minimal ros/console.h
+// whose ROS_*_STREAM macros expand the same way as rosconsole's, headers with
+// mixed header guards, and translation units holding classes whose
+// constructors initialise members out of order and with repeated literals
+// followed by a function full of stream log calls.
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <sys/stat.h>
+
+namespace {
+
+struct Config {
+  std::string Out;
+  int Tus = 50;
+  int LogCalls = 200;
+  int Headers = 20;
+  int IncludesPerTu = 5;
+  int ClassesPerHeader = 4;
+  int ClassesPerTu = 4;
+  int Fields = 16;
+  int LiteralInits = 4;
+};
+
+const char *Usage =
+    "usage: synthetic_ros_gen --out=DIR [--tus=N] [--log-calls=N]\n"
+    "                         [--headers=N] [--includes-per-tu=N]\n"
+    "                         [--classes-per-header=N] [--classes-per-tu=N]\n"
+    "                         [--fields=N] [--literal-inits=N]\n";
+
+bool parseArgs(int argc, char **argv, Config &Cfg) {
+  std::map<std::string, int *> IntFlags = {
+      {"--tus", &Cfg.Tus},
+      {"--log-calls", &Cfg.LogCalls},
+      {"--headers", &Cfg.Headers},
+      {"--includes-per-tu", &Cfg.IncludesPerTu},
+      {"--classes-per-header", &Cfg.ClassesPerHeader},
+      {"--classes-per-tu", &Cfg.ClassesPerTu},
+      {"--fields", &Cfg.Fields},
+      {"--literal-inits", &Cfg.LiteralInits},
+  };
+  for (int I = 1; I < argc; ++I) {
+    std::string Arg = argv[I];
+    auto Eq = Arg.find('=');
+    if (Eq == std::string::npos)
+      return false;
+    std::string Name = Arg.substr(0, Eq);
+    std::string Value = Arg.substr(Eq + 1);
+    if (Name == "--out") {
+      Cfg.Out = Value;
+      continue;
+    }
+    auto It = IntFlags.find(Name);
+    if (It == IntFlags.end())
+      return false;
+    *It->second = std::atoi(Value.c_str());
+  }
+  return !Cfg.Out.empty();
+}
+
+void makeDir(const std::string &Path) { mkdir(Path.c_str(), 0755); }
+
+void writeConsoleStub(const Config &Cfg) {
+  makeDir(Cfg.Out + "/include/ros");
+  std::ofstream Os(Cfg.Out + "/include/ros/console.h");
+  Os << R"(#ifndef ROS_CONSOLE_H
+#define ROS_CONSOLE_H
+#include <sstream>
+#include <string>
+
+namespace ros {
+namespace console {
+enum Level { Debug, Info, Warn, Error, Fatal };
+bool isEnabled(Level L);
+void print(Level L, const std::string &Msg);
+} // namespace console
+} // namespace ros
+
+#define ROS_LOG_STREAM(level, args)                                           \
+  do {                                                                        \
+    if (::ros::console::isEnabled(level)) {                                   \
+      std::stringstream __rosconsole_print_stream_at_location_with_filter__ss__; \
+      __rosconsole_print_stream_at_location_with_filter__ss__ << args;        \
+      ::ros::console::print(                                                  \
+          level,                                                              \
+          __rosconsole_print_stream_at_location_with_filter__ss__.str());     \
+    }                                                                         \
+  } while (false)
+
+#define ROS_DEBUG_STREAM(args) ROS_LOG_STREAM(::ros::console::Debug, args)
+#define ROS_INFO_STREAM(args) ROS_LOG_STREAM(::ros::console::Info, args)
+#define ROS_WARN_STREAM(args) ROS_LOG_STREAM(::ros::console::Warn, args)
+#define ROS_ERROR_STREAM(args) ROS_LOG_STREAM(::ros::console::Error, args)
+#define ROS_FATAL_STREAM(args) ROS_LOG_STREAM(::ros::console::Fatal, args)
+#endif
+)";
+}
+
+const char *FieldTypes[] = {"int", "double", "float", "char", "long"};
+
+/// A class whose default constructor initialises every field in reverse
+/// order and whose second constructor repeats the same literals as the first
+/// for the leading fields.
+void writeClass(const Config &Cfg, std::ostream &Os, const std::string &Class) {
+  Os << "class " << Class << " {\npublic:\n";
+  Os << "  " << Class << "()";
+  for (int F = Cfg.Fields - 1; F >= 0; --F)
+    Os << (F == Cfg.Fields - 1 ? " : " : ", ") << "f" << F << "_(" << F << ")";
+  Os << " {}\n";
+  Os << "  explicit " << Class << "(int v)";
+  for (int F = 0; F < Cfg.Fields; ++F) {
+    Os << (F ? ", " : " : ") << "f" << F << "_(";
+    if (F < Cfg.LiteralInits)
+      Os << F;
+    else
+      Os << "v";
+    Os << ")";
+  }
+  Os << " {}\n\nprivate:\n";
+  for (int F = 0; F < Cfg.Fields; ++F)
+    Os << "  " << FieldTypes[F % 5] << " f" << F << "_;\n";
+  Os << "};\n\n";
+}
+
+void writeHeader(const Config &Cfg, int H) {
+  std::string Name = "synthetic_" + std::to_string(H) + ".hpp";
+  std::ofstream Os(Cfg.Out + "/include/" + Name);
+  // Every other header uses a guard that mir-headercheck will rewrite.
+  std::string Guard = H % 2 ? "SYNTHETIC_" + std::to_string(H) + "_H"
+                            : "INCLUDE_SYNTHETIC_" + std::to_string(H) + "_HPP";
+  Os << "#ifndef " << Guard << "\n#define " << Guard << "\n\n";
+  for (int C = 0; C < Cfg.ClassesPerHeader; ++C)
+    writeClass(Cfg, Os, "Synthetic" + std::to_string(H) + "_" +
+                            std::to_string(C));
+  Os << "#endif\n";
+}
+
+void writeTu(const Config &Cfg, int T) {
+  std::ofstream Os(Cfg.Out + "/tu_" + std::to_string(T) + ".cpp");
+  Os << "#include <ros/console.h>\n#include <string>\n";
+  for (int I = 0; I < Cfg.IncludesPerTu && I < Cfg.Headers; ++I)
+    Os << "#include \"synthetic_" << (T + I) % Cfg.Headers << ".hpp\"\n";
+  Os << "\n";
+  // The class checks only look at the main file.
+  for (int C = 0; C < Cfg.ClassesPerTu; ++C)
+    writeClass(Cfg, Os, "Local" + std::to_string(T) + "_" + std::to_string(C));
+  Os << "void run" << T << "(int counter, double value, const std::string "
+     << "&name) {\n";
+  static const char *Levels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+  for (int L = 0; L < Cfg.LogCalls; ++L) {
+    Os << "  ROS_" << Levels[L % 4] << "_STREAM(\"step " << L
+       << " \" << counter << \" of \" << name << \": \" << value << " << L
+       << ");\n";
+  }
+  Os << "}\n";
+}
+
+void writeCompileCommands(const Config &Cfg) {
+  std::ofstream Os(Cfg.Out + "/compile_commands.json");
+  Os << "[\n";
+  for (int T = 0; T < Cfg.Tus; ++T) {
+    std::string File = "tu_" + std::to_string(T) + ".cpp";
+    Os << "  {\"directory\": \"" << Cfg.Out << "\", \"file\": \"" << Cfg.Out
+       << "/" << File << "\", \"arguments\": [\"clang++\", \"-std=c++17\", "
+       << "\"-I" << Cfg.Out << "/include\", \"-c\", \"" << File << "\"]}"
+       << (T + 1 < Cfg.Tus ? "," : "") << "\n";
+  }
+  Os << "]\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Config Cfg;
+  if (!parseArgs(argc, argv, Cfg)) {
+    std::cerr << Usage;
+    return 1;
+  }
+  makeDir(Cfg.Out);
+  makeDir(Cfg.Out + "/include");
+  writeConsoleStub(Cfg);
+  for (int H = 0; H < Cfg.Headers; ++H)
+    writeHeader(Cfg, H);
+  for (int T = 0; T < Cfg.Tus; ++T)
+    writeTu(Cfg, T);
+  writeCompileCommands(Cfg);
+  return 0;
+}
@@ -1,5 +1,42 @@
 #include <ros/console.h>
+#include <ros/ros.h>
+#include <sstream>
+#include <std_msgs/String.h>
 #include <string>
+#include <vector>
+
+namespace util {
+void logDebug(const std::string &text);
+} // namespace util
+
+void chatterCallback(std_msgs::String msg) {
+  ROS_INFO_STREAM("heard " << msg.data);
+}
+
+void latestCallback(const std_msgs::String::ConstPtr &msg) {
+  auto copy = *msg;
+  ROS_INFO_STREAM("latest " << copy.data);
+}
+
+class ScanStats {
+public:
+  ScanStats() : valid_(false), stamp_(0.0), seq_(0), range_(0.0) {}
+
+private:
+  bool valid_;
+  double stamp_;
+  [[clang::annotate("mir-hot")]] int seq_;
+  double range_;
+};
+
+// With mir-lazylogargs.EagerLoggers=util::logDebug, only the last call is
+// reported: member access through a ConstPtr and vector indexing are cheap.
+void namesCallback(const std_msgs::String::ConstPtr &msg,
+                   const std::vector<std::string> &names, size_t i) {
+  util::logDebug(msg->data);
+  util::logDebug(names[i]);
+  util::logDebug("names: " + std::to_string(names.size()));
+}
 
 int main(int argc, char **argv) {
   float j = 12;
@@ -10,5 +47,22 @@ int main(int argc, char **argv) {
   using namespace std::string_literals;
   ROS_INFO_STREAM("Hello World "s << 213 << j);
   ROS_INFO_STREAM("True or " << (true ? false : true));
+  ROS_WARN_STREAM_THROTTLE(1.0, "Throttled " << j);
+  ROS_DEBUG_STREAM_COND(argc > 1, "Got " << argc << " arguments");
+  ROS_INFO_STREAM_NAMED("main", "Named " << j);
+  std::string name = "main";
+  ROS_INFO("%s got %d arguments, j=%.2f", name.c_str(), argc, j);
+  ROS_WARN_THROTTLE(1.0, "count: %s", std::to_string(argc).c_str());
+  std::stringstream ss;
+  ss << "argc=" << argc;
+  ss << ", j=" << j;
+  ROS_INFO_STREAM(ss.str());
+  if (argc > 2) {
+    ros::init(argc, argv, "ex1");
+    ros::NodeHandle nh;
+    ros::Subscriber chatter = nh.subscribe("chatter", 1, chatterCallback);
+    ros::Subscriber latest = nh.subscribe("latest", 1, latestCallback);
+    ros::spin();
+  }
   return 0;
 }
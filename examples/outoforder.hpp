@@ -27,4 +27,16 @@ private:
   int g_{21};
 };
 
+class Tracker {
+public:
+  Tracker() : valid_(false), stamp_(0.0), seq_(0), rate_(10.0) {}
+
+private:
+  bool valid_;
+  double stamp_;
+  [[clang::annotate("mir-hot")]] int seq_;
+  double rate_;
+  char frame_{'m'};
+};
+
 #endif
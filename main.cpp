@@ -1,7 +1,17 @@
 // File lifted from /clang-tools-extra/test/clang-tidy/CTTestTidyModule.cpp
+#include "CheckMetrics.h"
 #include "HeaderincludeguardCheck.h"
+#include "LazyLogArgumentsCheck.h"
+#include "MessageCopyCheck.h"
+#include "MoveConstantInitToDeclaration.h"
+#include "NodeletSharedPublishCheck.h"
+#include "ParamLookupHoistCheck.h"
+#include "ProjectScopeCheck.h"
 #include "ReorderCtorInitializer.h"
+#include "ReorderFieldsForPadding.h"
+#include "RosprintftofmtCheck.h"
 #include "RosstreamtofmtCheck.h"
+#include "StringstreamtofmtCheck.h"
 #include "clang-tidy/ClangTidy.h"
 #include "clang-tidy/ClangTidyCheck.h"
 #include "clang-tidy/ClangTidyModule.h"
@@ -15,15 +25,40 @@ using namespace clang::ast_matchers;
 
 namespace {
 
+// Every check records its per-TU metrics when the MetricsFile option is set.
+template <typename T>
+void registerInstrumented(ClangTidyCheckFactories &CheckFactories,
+                          StringRef Name) {
+  CheckFactories.registerCheck<mir::InstrumentedCheck<T>>(Name);
+}
+
 class CTTestModule : public ClangTidyModule {
  public:
   void addCheckFactories(ClangTidyCheckFactories &CheckFactories) override {
-    CheckFactories.registerCheck<modernize::RosstreamtofmtCheck>(
-        "mir-rosstreamfmt");
-    CheckFactories.registerCheck<myplugin::MyHeaderGuardCheck>(
-        "mir-headercheck");
-    CheckFactories.registerCheck<modernize::ReorderCtorInitializer>(
-        "mir-reorder");
+    registerInstrumented<modernize::RosstreamtofmtCheck>(
+        CheckFactories, "mir-rosstreamfmt");
+    registerInstrumented<modernize::RosprintftofmtCheck>(
+        CheckFactories, "mir-rosprintffmt");
+    registerInstrumented<modernize::StringstreamtofmtCheck>(
+        CheckFactories, "mir-stringstreamfmt");
+    registerInstrumented<modernize::MessageCopyCheck>(
+        CheckFactories, "mir-msgcopy");
+    registerInstrumented<modernize::NodeletSharedPublishCheck>(
+        CheckFactories, "mir-nodeletpublish");
+    registerInstrumented<myplugin::MyHeaderGuardCheck>(
+        CheckFactories, "mir-headercheck");
+    registerInstrumented<modernize::ReorderCtorInitializer>(
+        CheckFactories, "mir-reorder");
+    registerInstrumented<modernize::ReorderFieldsForPadding>(
+        CheckFactories, "mir-fieldpadding");
+    registerInstrumented<modernize::MoveConstantInitToDeclaration>(
+        CheckFactories, "mir-moveinit");
+    registerInstrumented<modernize::ProjectScopeCheck>(
+        CheckFactories, "mir-projectscope");
+    registerInstrumented<modernize::LazyLogArgumentsCheck>(
+        CheckFactories, "mir-lazylogargs");
+    registerInstrumented<modernize::ParamLookupHoistCheck>(
+        CheckFactories, "mir-paramhoist");
   }
 };
 }  // namespace
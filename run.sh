@@ -10,6 +10,23 @@ source "${RUNFILES_DIR:-/dev/null}/$f" 2>/dev/null || \
   { echo>&2 "ERROR: cannot find $f"; exit 1; }; f=; set -e
 # --- end runfiles.bash initialization v2 ---
 
+# With a mir-migrate -serve running, hand the request to it instead of
+# starting clang-tidy and loading the plugin again. The server only takes
+# -fix, -checks=, -export-fixes= and sources; anything else, such as
+# -list-checks or --extra-arg=, still goes to clang-tidy.
+if [[ -S "${MIR_SOCKET:-}" ]]; then
+  served=1
+  for arg in "$@"; do
+    case "$arg" in
+      -fix|--fix|-checks=*|--checks=*|-export-fixes=*|--export-fixes=*) ;;
+      -*) served=0; break ;;
+    esac
+  done
+  if [[ $served == 1 ]]; then
+    exec "$(rlocation external-tidy-module/mir-client)" "$MIR_SOCKET" "$@"
+  fi
+fi
+
 CT=$(rlocation llvm_toolchain_llvm/bin/clang-tidy)
 PLUGIN=$(rlocation external-tidy-module/custom_plugin.so)
 
@@ -13,9 +13,10 @@ source "${RUNFILES_DIR:-/dev/null}/$f" 2>/dev/null || \
 RUNNER=$(rlocation external-tidy-module/run)
 
 CHECKS=$($RUNNER -checks="-*,mir-*" -list-checks)
-if [[ "$CHECKS" =~ "mir-headercheck" ]]; then
-  echo "Passed"
-else
-  echo "Failed $CHECKS"
-  exit 1
-fi;
+for CHECK in mir-fieldpadding mir-headercheck mir-lazylogargs mir-moveinit mir-msgcopy mir-nodeletpublish mir-paramhoist mir-projectscope mir-rosprintffmt mir-stringstreamfmt; do
+  if [[ ! "$CHECKS" =~ "$CHECK" ]]; then
+    echo "Failed $CHECK missing from $CHECKS"
+    exit 1
+  fi;
+done
+echo "Passed"
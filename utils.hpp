@@ -1,17 +1,176 @@
 #ifndef CLANG_TIDY_EXTERNAL_MODULE_UTILS_HPP_
 #define CLANG_TIDY_EXTERNAL_MODULE_UTILS_HPP_
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/Stmt.h"
+#include "clang/Basic/LangOptions.h"
 #include "clang/Basic/SourceManager.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/raw_ostream.h"
 namespace clang::tidy::modernize {
 
+// The lexer only needs language options to find token boundaries, so one
+// default instance serves every query.
+inline const clang::LangOptions &getSourceTextLangOptions() {
+  static const clang::LangOptions Lo;
+  return Lo;
+}
+
 template <typename T>
-llvm::StringRef getExprAsString(clang::SourceManager &Sm, const T &Ex) {
-  clang::LangOptions Lo;
+llvm::StringRef getExprAsString(const clang::SourceManager &Sm, const T &Ex) {
   // get the text from lexer including newlines and other formatting?
   auto Str = clang::Lexer::getSourceText(
       clang::CharSourceRange::getTokenRange(Ex.getSourceRange()), Sm,
-      clang::LangOptions());
+      getSourceTextLangOptions());
   return Str;
 }
 
+inline llvm::StringRef getSourceRangeAsString(const clang::SourceManager &Sm,
+                                              const clang::SourceRange &Range) {
+  const auto &Lo = getSourceTextLangOptions();
+  auto StartLoc = Sm.getSpellingLoc(Range.getBegin());
+  auto LastTokenLoc = Sm.getSpellingLoc(Range.getEnd());
+  auto EndLoc = clang::Lexer::getLocForEndOfToken(LastTokenLoc, 0, Sm, Lo);
+  return clang::Lexer::getSourceText(
+      clang::CharSourceRange::getCharRange(clang::SourceRange{StartLoc, EndLoc}),
+      Sm, Lo);
+}
+
+// The range to delete to remove statement S: the lines it occupies when
+// nothing else shares them, otherwise just the statement and its semicolon.
+// Invalid if S does not end in a semicolon in the same file.
+inline clang::CharSourceRange
+getStatementRemovalRange(const clang::Stmt &S, const clang::SourceManager &Sm,
+                         const clang::LangOptions &Lo) {
+  clang::SourceLocation Semi = S.getEndLoc();
+  if (!llvm::isa<clang::DeclStmt>(S)) {
+    auto Next = clang::Lexer::findNextToken(Semi, Sm, Lo);
+    if (!Next || !Next->is(clang::tok::semi))
+      return {};
+    Semi = Next->getLocation();
+  }
+  if (!S.getBeginLoc().isFileID() || !Semi.isFileID())
+    return {};
+  auto [Fid, Begin] = Sm.getDecomposedLoc(S.getBeginLoc());
+  auto [SemiFid, End] = Sm.getDecomposedLoc(Semi);
+  if (SemiFid != Fid)
+    return {};
+  ++End;
+  llvm::StringRef Buffer = Sm.getBufferData(Fid);
+  unsigned LineBegin = Begin, LineEnd = End;
+  while (LineBegin > 0 &&
+         (Buffer[LineBegin - 1] == ' ' || Buffer[LineBegin - 1] == '\t'))
+    --LineBegin;
+  while (LineEnd < Buffer.size() &&
+         (Buffer[LineEnd] == ' ' || Buffer[LineEnd] == '\t'))
+    ++LineEnd;
+  if ((LineBegin == 0 || Buffer[LineBegin - 1] == '\n') &&
+      (LineEnd == Buffer.size() || Buffer[LineEnd] == '\n')) {
+    Begin = LineBegin;
+    End = LineEnd == Buffer.size() ? LineEnd : LineEnd + 1;
+  }
+  clang::SourceLocation Start = Sm.getComposedLoc(Fid, Begin);
+  return clang::CharSourceRange::getCharRange(
+      Start, Start.getLocWithOffset(End - Begin));
+}
+
+// Whether Call is an expression statement directly in a block, so that it
+// can be wrapped or replaced without touching an enclosing expression.
+inline bool isStatementInBlock(const clang::CallExpr &Call,
+                               clang::ASTContext &Ctx) {
+  const clang::Stmt *S = &Call;
+  while (true) {
+    auto Parents = Ctx.getParents(*S);
+    if (Parents.size() != 1)
+      return false;
+    if (const auto *Cleanups = Parents[0].get<clang::ExprWithCleanups>()) {
+      S = Cleanups;
+      continue;
+    }
+    return Parents[0].get<clang::CompoundStmt>() != nullptr;
+  }
+}
+
+// Writes Text as the body of a C++ string literal. With EscapeBraces the
+// result is also a valid fmt format string that prints Text verbatim.
+inline void writeEscapedLiteral(llvm::raw_ostream &OS, llvm::StringRef Text,
+                                bool EscapeBraces) {
+  for (unsigned char C : Text) {
+    switch (C) {
+    case '"':
+      OS << "\\\"";
+      break;
+    case '\\':
+      OS << "\\\\";
+      break;
+    case '\n':
+      OS << "\\n";
+      break;
+    case '\t':
+      OS << "\\t";
+      break;
+    case '\r':
+      OS << "\\r";
+      break;
+    case '{':
+    case '}':
+      OS << C;
+      if (EscapeBraces)
+        OS << C;
+      break;
+    default:
+      if (C < 0x20 || C == 0x7f) {
+        // octal escapes never swallow a following digit beyond three
+        OS << '\\' << char('0' + (C >> 6)) << char('0' + ((C >> 3) & 7))
+           << char('0' + (C & 7));
+      } else {
+        OS << C;
+      }
+    }
+  }
+}
+
+// Assembles replacement text without intermediate strings. Pieces are either
+// slices that already outlive the builder (SourceManager buffers, AST string
+// literals) or short synthesized text copied into the check's arena, which
+// is freed with the check: clang-tidy creates check instances per TU. The
+// result is written once into a caller-provided buffer.
+class SourceTextBuilder {
+public:
+  explicit SourceTextBuilder(llvm::StringSaver &Saver) : Saver(Saver) {}
+
+  void append(llvm::StringRef Text) { Pieces.push_back(Text); }
+  void appendCopy(const llvm::Twine &Text) {
+    Pieces.push_back(Saver.save(Text));
+  }
+  void appendJoined(llvm::ArrayRef<llvm::StringRef> Items,
+                    llvm::StringRef Separator) {
+    for (size_t I = 0; I < Items.size(); ++I) {
+      if (I)
+        Pieces.push_back(Separator);
+      Pieces.push_back(Items[I]);
+    }
+  }
+
+  void writeTo(llvm::raw_ostream &OS) const {
+    for (llvm::StringRef Piece : Pieces)
+      OS << Piece;
+  }
+  llvm::StringRef render(llvm::SmallVectorImpl<char> &Out) const {
+    Out.clear();
+    llvm::raw_svector_ostream OS(Out);
+    writeTo(OS);
+    return OS.str();
+  }
+
+private:
+  llvm::StringSaver &Saver;
+  llvm::SmallVector<llvm::StringRef, 16> Pieces;
+};
+
 }  // namespace clang::tidy::modernize
 #endif